@@ -24,6 +24,7 @@ breathe_doxygen_config_options = {
     'ENABLE_PREPROCESSING': 'YES',
     'MACRO_EXPANSION': 'YES',
     'EXPAND_ONLY_PREDEF': 'NO',
+    'PREDEFINED': 'AXMC_PROFILING',  # Documents the classes that are only compiled in the profiling builds.
 }
 
 # -- Options for HTML output -------------------------------------------------
@@ -0,0 +1,399 @@
+/**
+ * @file
+ * @brief The header-only file for the AdcFrontend class. This class allows acquiring analog readouts without blocking
+ * the main runtime loop while the conversions are in progress.
+ *
+ * Modules request conversions and return control to the Kernel. The conversions are carried out by ADC1 one at a
+ * time, in the order they were requested, and each completed conversion raises an interrupt that stores the readout
+ * and starts the next pending conversion. Instead of averaging multiple blocking readouts in software, each request
+ * can use the ADC hardware averaging, which is applied by the converter itself.
+ *
+ * Two pins can be paired, in which case they are converted simultaneously: the first pin by ADC1 and the second pin
+ * by ADC2. Both readouts of a pair share the same timestamp, which keeps the paired data phase-aligned and doubles
+ * the conversion throughput for the pair. ADC2 can also be claimed by the AdcStream or the AdcWatchdog (see
+ * ClaimAdc2()). While it is claimed, the pins of each pair are converted one after another by ADC1, and each readout
+ * receives the timestamp of its own conversion.
+ *
+ * @attention This file targets the iMXRT1062 microcontroller used by Teensy 4.0 and 4.1 boards. The front-end takes
+ * over ADC1, so the Arduino analogRead() function (and, by extension, Module::AnalogRead()) must not be used for
+ * ADC1 pins while the front-end is in use. If any pins are paired, the front-end also uses ADC2 whenever it is not
+ * claimed.
+ *
+ * @section adc_fe_dependencies Dependencies:
+ * - Arduino.h for Arduino platform functions and macros and cross-compatibility with Arduino IDE (to an extent).
+ */
+
+#ifndef AXMC_ADC_FRONTEND_H
+#define AXMC_ADC_FRONTEND_H
+
+#include <cstdint>
+#include <Arduino.h>
+
+/**
+ * @brief Translates a Teensy 4.0 analog pin number into the iMXRT ADC input channel number.
+ *
+ * This mirrors the pin-to-channel table used by the Teensy core, which is not exposed to user code. Pins 14 through
+ * 23 (A0 through A9) are wired to the same input channel on both ADC1 and ADC2.
+ *
+ * @param pin the analog pin number.
+ * @returns the ADC input channel number or 255 if the pin is not connected to both ADCs.
+ */
+constexpr uint8_t ResolveAdcChannel(const uint8_t pin)
+{
+    constexpr uint8_t kChannels[] = {7, 8, 12, 11, 6, 5, 15, 0, 13, 14};  // Pins 14 to 23.
+    return (pin >= 14 && pin <= 23) ? kChannels[pin - 14] : 255;
+}
+
+/**
+ * @brief Schedules interrupt-driven ADC1 (and, for paired pins, ADC2) conversions requested by multiple modules.
+ *
+ * Each module registers its pin once to receive a slot and then uses the slot to request conversions and to collect
+ * the completed readouts. All methods are static, as the class manages the single set of converters.
+ */
+class AdcFrontend
+{
+    public:
+        /// The maximum number of pins that can be registered with the front-end.
+        static constexpr uint8_t kMaxSlots = 8;
+
+        /// The slot value returned when the pin could not be registered.
+        static constexpr uint8_t kInvalidSlot = 255;
+
+        /**
+         * @brief Registers the pin with the front-end. Registering the same pin multiple times returns the same slot.
+         *
+         * @param pin the analog pin to convert.
+         * @returns the slot used to request conversions for the pin, or kInvalidSlot if the pin is not connected to
+         * the ADCs or all slots are taken.
+         */
+        static uint8_t Register(const uint8_t pin)
+        {
+            // Rejects the pins without an ADC channel. The conversion of such a pin would never complete and would
+            // stall all other slots.
+            const uint8_t channel = ResolveAdcChannel(pin);
+            if (channel == 255) return kInvalidSlot;
+            for (uint8_t slot = 0; slot < _slot_count; ++slot)
+            {
+                if (_channels[slot] == channel) return slot;
+            }
+            if (_slot_count == kMaxSlots) return kInvalidSlot;
+
+            // Routes the ADC1 conversion-complete interrupt to the front-end when the first pin is registered.
+            if (_slot_count == 0)
+            {
+                attachInterruptVector(IRQ_ADC1, HandleConversion);
+                NVIC_ENABLE_IRQ(IRQ_ADC1);
+            }
+
+            _channels[_slot_count] = channel;
+            return _slot_count++;
+        }
+
+        /**
+         * @brief Pairs the two pins, so that they are converted simultaneously by ADC1 and ADC2. Registers the pins if
+         * they are not registered yet.
+         *
+         * A request for either pin converts both pins, using the hardware averaging of the request that started the
+         * conversion.
+         *
+         * @note Call this method before the modules that use the pins start requesting conversions (for example, in
+         * setup(), before the Kernel is set up).
+         *
+         * @param first_pin the pin converted by ADC1.
+         * @param second_pin the pin converted by ADC2.
+         * @returns true if the pins were paired and false if they could not be registered or one of them is already
+         * paired.
+         */
+        static bool Pair(const uint8_t first_pin, const uint8_t second_pin)
+        {
+            const uint8_t first  = Register(first_pin);
+            const uint8_t second = Register(second_pin);
+            if (first == kInvalidSlot || second == kInvalidSlot || first == second) return false;
+            if (_partners[first] != kInvalidSlot || _partners[second] != kInvalidSlot) return false;
+
+            // The lower slot leads the pair: it holds the pending bit and the round-robin position of the whole pair.
+            _partners[first]  = second;
+            _partners[second] = first;
+            _adc2_slots[first < second ? first : second] = second;
+            return true;
+        }
+
+        /// Returns true if the slot is paired with another slot.
+        static bool IsPaired(const uint8_t slot)
+        {
+            return slot < _slot_count && _partners[slot] != kInvalidSlot;
+        }
+
+        /**
+         * @brief Claims the exclusive use of ADC2.
+         *
+         * ADC2 can only be claimed by one user at a time: the continuous AdcStream or the AdcWatchdog. Each of these
+         * has to claim ADC2 before reconfiguring it and release it when done. While ADC2 is claimed, paired pins are
+         * converted by ADC1 alone. If a paired conversion is in progress when ADC2 is claimed, its ADC2 readout is
+         * discarded and the pin is converted again by ADC1.
+         *
+         * @returns true if ADC2 was claimed and false if it is already in use.
+         */
+        static bool ClaimAdc2()
+        {
+            __disable_irq();
+            const bool claimed = !_adc2_claimed;
+            _adc2_claimed      = true;
+            __enable_irq();
+            return claimed;
+        }
+
+        /// Releases ADC2 claimed with ClaimAdc2(), allowing other users to claim it.
+        static void ReleaseAdc2()
+        {
+            _adc2_claimed = false;
+        }
+
+        /**
+         * @brief Requests a conversion for the slot. Does nothing if the slot already has a pending or ongoing
+         * conversion.
+         *
+         * @param slot the slot returned by Register().
+         * @param pool_size the number of readouts to average into the converted value. The ADC supports averaging 4, 8,
+         * 16 or 32 readouts, so the pool size is rounded up to the nearest supported value. Values of 0 and 1 disable
+         * averaging.
+         */
+        static void Request(const uint8_t slot, const uint8_t pool_size)
+        {
+            if (slot >= _slot_count) return;
+
+            // Paired slots are requested through the lead slot of the pair.
+            const uint8_t lead = _partners[slot] < slot ? _partners[slot] : slot;
+
+            __disable_irq();
+            if (_active != lead && !(_pending & (1U << lead)))
+            {
+                _averaging[lead] = ResolveAveraging(pool_size);
+                if (_active == kIdle) StartConversion(lead);
+                else _pending |= 1U << lead;
+            }
+            __enable_irq();
+        }
+
+        /**
+         * @brief Retrieves the readout of the last completed conversion for the slot.
+         *
+         * @param slot the slot returned by Register().
+         * @param value the variable to store the readout in.
+         * @returns true if a new readout was available and false if the conversion has not completed yet (or was never
+         * requested).
+         */
+        static bool Read(const uint8_t slot, uint16_t& value)
+        {
+            uint32_t timestamp;
+            return Read(slot, value, timestamp);
+        }
+
+        /**
+         * @brief Retrieves the readout of the last completed conversion for the slot and the time the conversion was
+         * started.
+         *
+         * @param slot the slot returned by Register().
+         * @param value the variable to store the readout in.
+         * @param timestamp the variable to store the micros() time at which the conversion was started in. Both slots
+         * of a pair receive the same timestamp.
+         * @returns true if a new readout was available and false if the conversion has not completed yet (or was never
+         * requested).
+         */
+        static bool Read(const uint8_t slot, uint16_t& value, uint32_t& timestamp)
+        {
+            if (slot >= _slot_count || !(_ready & (1U << slot))) return false;
+
+            __disable_irq();
+            value     = _values[slot];
+            timestamp = _timestamps[slot];
+            _ready &= ~(1U << slot);
+            __enable_irq();
+            return true;
+        }
+
+    private:
+        /// The value used to mark the ADC as idle.
+        static constexpr uint8_t kIdle = kInvalidSlot;
+
+        /// The maximum number of CPU cycles the ADC1 interrupt waits for the paired ADC2 conversion to complete.
+        /// Both converters start within a few bus cycles of each other, so this is only exceeded if ADC2 stalls.
+        static constexpr uint32_t kAdc2Timeout = 600;
+
+        /// Translates the requested pool size into the ADC_CFG AVGS field value, or 0xFF to disable averaging.
+        static constexpr uint8_t ResolveAveraging(const uint8_t pool_size)
+        {
+            return pool_size <= 1 ? 0xFF : pool_size <= 4 ? 0 : pool_size <= 8 ? 1 : pool_size <= 16 ? 2 : 3;
+        }
+
+        /// Configures the hardware averaging and starts the conversion for the slot (or both slots of a pair). Has to
+        /// be called with interrupts disabled or from the conversion-complete interrupt.
+        static void StartConversion(const uint8_t slot)
+        {
+            const uint8_t partner = _partners[slot];
+            if (partner == kInvalidSlot)
+            {
+                StartSingle(slot, _averaging[slot]);
+                return;
+            }
+
+            // Converts the pair one pin after another if ADC2 is claimed by another user. The second pin is started
+            // by the interrupt that completes the first one.
+            const uint8_t adc2_slot = _adc2_slots[slot];
+            const uint8_t adc1_slot = adc2_slot == slot ? partner : slot;
+            if (_adc2_claimed)
+            {
+                _follower = adc2_slot;
+                StartSingle(adc1_slot, _averaging[slot]);
+                return;
+            }
+
+            const uint8_t averaging = _averaging[slot];
+            if (averaging == 0xFF)
+            {
+                ADC1_GC &= ~ADC_GC_AVGE;
+                ADC2_GC &= ~ADC_GC_AVGE;
+            }
+            else
+            {
+                ADC1_CFG = (ADC1_CFG & ~ADC_CFG_AVGS(3)) | ADC_CFG_AVGS(averaging);
+                ADC1_GC |= ADC_GC_AVGE;
+                ADC2_CFG = (ADC2_CFG & ~ADC_CFG_AVGS(3)) | ADC_CFG_AVGS(averaging);
+                ADC2_GC |= ADC_GC_AVGE;
+            }
+
+            // Starts both conversions with back-to-back register writes, which skews them by a few bus cycles. Since
+            // both converters use the same clock and averaging configuration, they also complete together, so only
+            // ADC1 raises the interrupt.
+            _active    = slot;
+            _dual      = true;
+            _timestamp = micros();
+            ADC2_HC0   = ADC_HC_ADCH(_channels[adc2_slot]);
+            ADC1_HC0   = ADC_HC_AIEN | ADC_HC_ADCH(_channels[adc1_slot]);
+        }
+
+        /// Configures the hardware averaging and starts the ADC1 conversion for the slot alone.
+        static void StartSingle(const uint8_t slot, const uint8_t averaging)
+        {
+            if (averaging == 0xFF) ADC1_GC &= ~ADC_GC_AVGE;
+            else
+            {
+                ADC1_CFG = (ADC1_CFG & ~ADC_CFG_AVGS(3)) | ADC_CFG_AVGS(averaging);
+                ADC1_GC |= ADC_GC_AVGE;
+            }
+
+            _active    = slot;
+            _dual      = false;
+            _timestamp = micros();
+            ADC1_HC0   = ADC_HC_AIEN | ADC_HC_ADCH(_channels[slot]);
+        }
+
+        /// Waits for the paired ADC2 conversion to complete. Returns false if ADC2 was claimed by another user since
+        /// the conversion was started or the conversion did not complete within kAdc2Timeout cycles.
+        static bool AwaitAdc2()
+        {
+            if (_adc2_claimed) return false;
+            const uint32_t start = ARM_DWT_CYCCNT;
+            while (!(ADC2_HS & ADC_HS_COCO0))
+            {
+                if (ARM_DWT_CYCCNT - start > kAdc2Timeout) return false;
+            }
+            return true;
+        }
+
+        /// Stores the completed conversion and starts the next pending one. Called by the ADC1 conversion-complete
+        /// interrupt.
+        static void HandleConversion()
+        {
+            const uint8_t slot = _active;
+            const auto value   = static_cast<uint16_t>(ADC1_R0);  // Reading the result clears the interrupt flag.
+            _active            = kIdle;
+            if (slot == kIdle) return;
+
+            if (!_dual) Store(slot, value);
+            else
+            {
+                // The lead slot of the pair is active, so the ADC1 readout belongs to the slot not converted by ADC2.
+                const uint8_t adc2_slot = _adc2_slots[slot];
+                Store(adc2_slot == slot ? _partners[slot] : slot, value);
+
+                // If the ADC2 readout is not available, converts the second pin with ADC1 instead.
+                if (AwaitAdc2()) Store(adc2_slot, static_cast<uint16_t>(ADC2_R0));
+                else _follower = adc2_slot;
+            }
+
+            // Converts the second pin of a pair that could not be converted by ADC2 before any other pending slot.
+            const uint8_t follower = _follower;
+            if (follower != kIdle)
+            {
+                _follower = kIdle;
+                StartSingle(follower, _averaging[follower < _partners[follower] ? follower : _partners[follower]]);
+                return;
+            }
+
+            // Services the pending slots in a round-robin order, starting after the slot that just completed.
+            if (_pending == 0) return;
+            for (uint8_t offset = 1; offset <= kMaxSlots; ++offset)
+            {
+                const uint8_t next = (slot + offset) % kMaxSlots;
+                if (_pending & (1U << next))
+                {
+                    _pending &= ~(1U << next);
+                    StartConversion(next);
+                    return;
+                }
+            }
+        }
+
+        /// Stores the readout of the completed conversion for the slot. Called by the conversion-complete interrupt.
+        static void Store(const uint8_t slot, const uint16_t value)
+        {
+            _values[slot]     = value;
+            _timestamps[slot] = _timestamp;
+            _ready |= 1U << slot;
+        }
+
+        /// The ADC input channel of each registered slot.
+        static inline uint8_t _channels[kMaxSlots] = {};
+
+        /// The ADC_CFG AVGS field value used by each slot's pending conversion.
+        static inline volatile uint8_t _averaging[kMaxSlots] = {};
+
+        /// The last completed readout of each slot.
+        static inline volatile uint16_t _values[kMaxSlots] = {};
+
+        /// The micros() time at which the last completed conversion of each slot was started.
+        static inline volatile uint32_t _timestamps[kMaxSlots] = {};
+
+        /// The paired slot of each slot, or kInvalidSlot for unpaired slots.
+        static inline uint8_t _partners[kMaxSlots] = {255, 255, 255, 255, 255, 255, 255, 255};
+
+        /// For the lead slot of each pair, the slot of the pair converted by ADC2.
+        static inline uint8_t _adc2_slots[kMaxSlots] = {};
+
+        /// Tracks whether ADC2 is claimed by the AdcStream or the AdcWatchdog.
+        static inline bool _adc2_claimed = false;
+
+        /// The micros() time at which the ongoing conversion was started.
+        static inline volatile uint32_t _timestamp = 0;
+
+        /// The number of registered slots.
+        static inline uint8_t _slot_count = 0;
+
+        /// The bitmask of slots waiting for the ADC to become available.
+        static inline volatile uint8_t _pending = 0;
+
+        /// The bitmask of slots with a completed, unread readout.
+        static inline volatile uint8_t _ready = 0;
+
+        /// The slot whose conversion is in progress, or kIdle.
+        static inline volatile uint8_t _active = kIdle;
+
+        /// Tracks whether the conversion in progress uses both converters.
+        static inline volatile bool _dual = false;
+
+        /// The slot of a pair that has to be converted by ADC1 after the conversion in progress, or kIdle.
+        static inline volatile uint8_t _follower = kIdle;
+};
+
+#endif  //AXMC_ADC_FRONTEND_H
@@ -0,0 +1,221 @@
+/**
+ * @file
+ * @brief The header-only file for the AdcStream class. This class allows continuously sampling an analog pin at a
+ * fixed, hardware-timed rate without involving the main runtime loop.
+ *
+ * The stream uses a Periodic Interrupt Timer (PIT) channel, managed through the IntervalTimer class, to start ADC2
+ * conversions at a fixed interval. The conversion results are moved into a circular buffer by a DMA channel, so the
+ * CPU only spends a few cycles per sample to start the conversion. The owning module drains the buffer whenever its
+ * command runs, which decouples the sampling clock from the RuntimeCycle() load.
+ *
+ * @attention This file targets the iMXRT1062 microcontroller used by Teensy 4.0 and 4.1 boards. The stream uses
+ * ADC2, as ADC1 is used by the Arduino analogRead() function and the AdcFrontend class. Only one stream can be active
+ * at any given time. While the stream runs, the paired pins are converted one after another by ADC1 (see
+ * adc_frontend.h).
+ *
+ * @section adc_str_dependencies Dependencies:
+ * - Arduino.h for Arduino platform functions and macros and cross-compatibility with Arduino IDE (to an extent).
+ * - DMAChannel.h for the Teensy DMA channel management class.
+ * - IntervalTimer.h for the Teensy PIT channel management class.
+ * - adc_frontend.h for the pin-to-ADC-channel translation and ADC2 arbitration.
+ */
+
+#ifndef AXMC_ADC_STREAM_H
+#define AXMC_ADC_STREAM_H
+
+#include <cstdint>
+#include <Arduino.h>
+#include <DMAChannel.h>
+#include <IntervalTimer.h>
+#include "adc_frontend.h"
+
+/**
+ * @brief Continuously samples the managed analog pin at a fixed rate and buffers the readouts in a DMA-filled
+ * circular buffer.
+ *
+ * @tparam kPin the analog pin to sample.
+ * @tparam kBufferSize the number of samples the circular buffer can hold. Has to be a power of two. The buffer has to
+ * be drained at least once every kBufferSize sampling intervals to avoid losing data.
+ */
+template <const uint8_t kPin, const uint16_t kBufferSize = 4096>
+class AdcStream
+{
+        // Ensures that the pin can be sampled by ADC2.
+        static_assert(
+            ResolveAdcChannel(kPin) != 255,
+            "The AdcStream pin has to be one of the Teensy 4.0 analog pins available to ADC2 (14 through 23)."
+        );
+
+        // Ensures that the buffer index can be resolved with a bitmask.
+        static_assert(
+            kBufferSize != 0 && (kBufferSize & (kBufferSize - 1)) == 0,
+            "The AdcStream buffer size has to be a power of two."
+        );
+
+    public:
+        /// Starts sampling the pin every interval microseconds. Returns false if the interval is zero, ADC2 is
+        /// claimed by another user, or the hardware timer could not be allocated.
+        bool Start(const uint16_t interval)
+        {
+            if (interval == 0) return false;
+            Stop();
+            if (!AdcFrontend::ClaimAdc2()) return false;
+
+            _read_index  = 0;
+            _issued      = 0;
+            _consumed    = 0;
+            _interval    = interval;
+
+            // Configures the DMA channel (allocated at construction) to move each conversion result from ADC2 into the
+            // circular buffer. The destination address rolls back to the start of the buffer after each major loop, and
+            // the channel is never disabled on completion. The buffer is kept in the (uncached) DTCM, so no cache
+            // maintenance is needed.
+            _dma.source(reinterpret_cast<volatile uint16_t&>(ADC2_R0));
+            _dma.destinationBuffer(_buffer, sizeof(_buffer));
+            _dma.triggerAtHardwareEvent(DMAMUX_SOURCE_ADC2);
+            _dma.enable();
+
+            // Switches ADC2 to software-triggered, DMA-serviced conversions. Also disables the hardware averaging left
+            // behind by the paired AdcFrontend conversions, so that the conversion time does not depend on them.
+            ADC2_CFG &= ~(ADC_CFG_ADTRG | ADC_CFG_AVGS(3));
+            ADC2_GC = (ADC2_GC & ~ADC_GC_AVGE) | ADC_GC_DMAEN;
+
+            // Starts the sampling clock. The timer runs at a high priority to keep the sampling interval uniform.
+            _timer.priority(16);
+            if (!_timer.begin(TriggerConversion, static_cast<uint32_t>(interval)))
+            {
+                _active = true;  // Ensures Stop() releases the claimed hardware.
+                Stop();
+                return false;
+            }
+
+            _active = true;
+            return true;
+        }
+
+        /// Stops sampling the pin and releases ADC2 to its default (interrupt-driven) configuration.
+        void Stop()
+        {
+            if (!_active) return;
+            _timer.end();
+            ADC2_GC &= ~ADC_GC_DMAEN;
+            _dma.disable();
+            _active = false;
+            AdcFrontend::ReleaseAdc2();
+        }
+
+        /// Returns true if the stream is currently sampling the pin.
+        [[nodiscard]] bool IsActive() const
+        {
+            return _active;
+        }
+
+        /// Returns the number of samples that were written to the buffer, but not yet read.
+        [[nodiscard]] uint16_t Available() const
+        {
+            return static_cast<uint16_t>((WriteIndex() - _read_index) & kIndexMask);
+        }
+
+        /// Reads the next buffered sample into the provided variable. Returns false if the buffer is empty.
+        bool Read(uint16_t& sample)
+        {
+            if (_read_index == WriteIndex()) return false;
+            sample      = _buffer[_read_index];
+            _read_index = (_read_index + 1) & kIndexMask;
+            ++_consumed;
+            return true;
+        }
+
+        /**
+         * @brief Checks whether the stream overwrote unread samples since the last call and, if so, discards the
+         * buffer contents.
+         *
+         * @returns the number of samples that were lost, which is 0 if the stream is intact.
+         */
+        uint32_t ResolveOverrun()
+        {
+            // The conversion started by the most recent trigger may still be in progress, so one sample of slack is
+            // allowed before declaring the buffer overwritten.
+            const uint32_t lost = _issued - _consumed;
+            if (lost < kBufferSize) return 0;
+
+            // Resynchronizes with the DMA write position. The discarded samples still count towards the consumed total
+            // so that sample timestamps remain aligned to the sampling clock (to within the one in-flight conversion).
+            _read_index = WriteIndex();
+            _consumed   = _issued;
+            return lost;
+        }
+
+        /// Returns the index of the next sample returned by Read(), counted from the start of the stream.
+        [[nodiscard]] uint32_t GetSampleIndex() const
+        {
+            return _consumed;
+        }
+
+        /// Returns the micros() time at which the first sample was triggered. The timer fires the first trigger one
+        /// interval after the stream is started, so this is only valid once the first sample was read.
+        [[nodiscard]] uint32_t GetStartTime() const
+        {
+            return _start_time;
+        }
+
+        /// Returns the interval, in microseconds, between consecutive samples.
+        [[nodiscard]] uint16_t GetInterval() const
+        {
+            return _interval;
+        }
+
+    private:
+        /// Stores the ADC input channel connected to the sampled pin.
+        static constexpr uint8_t kChannel = ResolveAdcChannel(kPin);
+
+        /// Stores the bitmask used to wrap buffer indices.
+        static constexpr uint16_t kIndexMask = kBufferSize - 1;
+
+        /// Stores the number of conversions started by the sampling timer. This and the start time are the only state
+        /// shared with the timer interrupt.
+        static inline volatile uint32_t _issued = 0;
+
+        /// The micros() time at which the first sample was triggered. Latched by the first timer interrupt.
+        static inline volatile uint32_t _start_time = 0;
+
+        /// Starts a single ADC2 conversion. Called by the sampling timer interrupt.
+        static void TriggerConversion()
+        {
+            ADC2_HC0 = kChannel;
+            if (_issued == 0) _start_time = micros();
+            _issued = _issued + 1;
+        }
+
+        /// Resolves the buffer index the DMA channel writes the next sample to.
+        [[nodiscard]] uint16_t WriteIndex() const
+        {
+            const auto address = reinterpret_cast<uintptr_t>(_dma.TCD->DADDR);
+            return static_cast<uint16_t>(
+                ((address - reinterpret_cast<uintptr_t>(_buffer)) / sizeof(uint16_t)) & kIndexMask
+            );
+        }
+
+        /// The circular buffer filled by the DMA channel.
+        alignas(32) volatile uint16_t _buffer[kBufferSize] = {};
+
+        /// The DMA channel that moves conversion results into the buffer.
+        DMAChannel _dma;
+
+        /// The PIT channel that clocks the conversions.
+        IntervalTimer _timer;
+
+        /// The buffer index of the next sample to be read.
+        uint16_t _read_index = 0;
+
+        /// The total number of samples read (or discarded due to overruns) since the stream was started.
+        uint32_t _consumed = 0;
+
+        /// The interval, in microseconds, between consecutive samples.
+        uint16_t _interval = 0;
+
+        /// Tracks whether the stream is currently active.
+        bool _active = false;
+};
+
+#endif  //AXMC_ADC_STREAM_H
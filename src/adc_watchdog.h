@@ -0,0 +1,222 @@
+/**
+ * @file
+ * @brief The header-only file for the AdcWatchdog class. This class allows detecting threshold crossings of an analog
+ * signal in hardware, without polling the signal from the main runtime loop.
+ *
+ * The watchdog puts ADC2 into continuous conversion mode and enables its hardware compare function. The converter
+ * only flags a conversion as complete (and raises the interrupt) when the result meets the compare condition, so the
+ * CPU is not involved until the signal crosses the threshold. The interrupt timestamps the crossing, queues it and
+ * flips the compare condition to wait for the opposite crossing. The two crossing thresholds can differ, which
+ * provides hysteresis against noise around the threshold.
+ *
+ * @attention This file targets the iMXRT1062 microcontroller used by Teensy 4.0 and 4.1 boards. The watchdog claims
+ * ADC2 through the AdcFrontend class, so it cannot run together with the AdcStream class. While the watchdog runs, the
+ * paired pins are converted one after another by ADC1 (see adc_frontend.h).
+ *
+ * @section adc_wd_dependencies Dependencies:
+ * - Arduino.h for Arduino platform functions and macros and cross-compatibility with Arduino IDE (to an extent).
+ * - adc_frontend.h for the pin-to-ADC-channel translation and ADC2 arbitration.
+ * - reward_link.h for firing the lick-triggered rewards directly from the crossing interrupt.
+ */
+
+#ifndef AXMC_ADC_WATCHDOG_H
+#define AXMC_ADC_WATCHDOG_H
+
+#include <cstdint>
+#include <Arduino.h>
+#include "adc_frontend.h"
+#include "reward_link.h"
+
+/// Stores a single threshold crossing detected by the AdcWatchdog class.
+struct AdcCrossing
+{
+        uint32_t timestamp = 0;  ///< The micros() time at which the crossing was detected.
+        uint16_t value     = 0;  ///< The conversion result that triggered the crossing.
+        bool rising        = false;  ///< Determines whether the signal crossed the upper (true) or lower threshold.
+};
+
+/**
+ * @brief Monitors the analog pin for threshold crossings using the ADC2 hardware compare function.
+ *
+ * The crossings are passed from the interrupt to the owning module through a single-producer, single-consumer
+ * lock-free queue, so reading the crossings never delays the crossing interrupt.
+ *
+ * @tparam kPin the analog pin to monitor.
+ * @tparam kQueueSize the number of crossings the queue can hold. Has to be a power of two.
+ */
+template <const uint8_t kPin, const uint8_t kQueueSize = 32>
+class AdcWatchdog
+{
+        // Ensures that the pin can be converted by ADC2.
+        static_assert(
+            ResolveAdcChannel(kPin) != 255,
+            "The AdcWatchdog pin has to be one of the Teensy 4.0 analog pins available to ADC2 (14 through 23)."
+        );
+
+        // Ensures that the queue index can be resolved with a bitmask.
+        static_assert(
+            kQueueSize != 0 && (kQueueSize & (kQueueSize - 1)) == 0,
+            "The AdcWatchdog queue size has to be a power of two."
+        );
+
+    public:
+        /**
+         * @brief Starts monitoring the pin.
+         *
+         * The watchdog first waits for the signal to rise to or above the upper threshold and then for the signal to
+         * fall below the lower threshold, alternating between the two.
+         *
+         * @param upper the threshold that has to be reached for a rising crossing.
+         * @param lower the threshold the signal has to fall below for a falling crossing.
+         * @returns true if the watchdog was started and false if ADC2 is claimed by another user.
+         */
+        bool Start(const uint16_t upper, const uint16_t lower)
+        {
+            Stop();
+            if (!AdcFrontend::ClaimAdc2()) return false;
+
+            _upper   = upper;
+            _lower   = lower > upper ? upper : lower;
+            _above   = false;
+            _head    = 0;
+            _tail    = 0;
+            _dropped = 0;
+
+            // Configures the compare function to wait for the rising crossing and starts continuous conversions.
+            attachInterruptVector(IRQ_ADC2, HandleCrossing);
+            NVIC_SET_PRIORITY(IRQ_ADC2, 32);  // Prioritizes the crossings to minimize the timestamp latency.
+            NVIC_ENABLE_IRQ(IRQ_ADC2);
+            ADC2_CFG &= ~ADC_CFG_ADTRG;
+            ADC2_CV = ADC_CV_CV1(_upper);
+            ADC2_GC = (ADC2_GC & ~ADC_GC_ACREN) | ADC_GC_ACFE | ADC_GC_ACFGT | ADC_GC_ADCO;
+            ADC2_HC0 = ADC_HC_AIEN | ADC_HC_ADCH(kChannel);
+
+            _active = true;
+            return true;
+        }
+
+        /// Stops monitoring the pin and releases ADC2.
+        void Stop()
+        {
+            if (!_active) return;
+
+            NVIC_DISABLE_IRQ(IRQ_ADC2);
+            ADC2_GC &= ~(ADC_GC_ACFE | ADC_GC_ACFGT | ADC_GC_ADCO);
+            ADC2_HC0 = ADC_HC_ADCH(31);  // Channel 31 disables the converter.
+            _active = false;
+            AdcFrontend::ReleaseAdc2();
+        }
+
+        /// Returns true if the watchdog is currently monitoring the pin.
+        [[nodiscard]] bool IsActive() const
+        {
+            return _active;
+        }
+
+        /// Retrieves the oldest queued crossing. Returns false if the queue is empty.
+        bool Read(AdcCrossing& crossing)
+        {
+            // Reads the head index before the entry it publishes. The compiler barrier keeps the entry reads after the
+            // head read, and the single core observes its own memory accesses in program order, so the entry is
+            // complete. The tail index is published only after the entry is copied, which keeps the interrupt from
+            // overwriting it.
+            const uint8_t tail = _tail;
+            if (tail == _head) return false;
+            __asm__ volatile("" ::: "memory");
+            crossing.timestamp = _queue[tail].timestamp;
+            crossing.value     = _queue[tail].value;
+            crossing.rising    = _queue[tail].rising;
+            __asm__ volatile("" ::: "memory");
+            _tail = (tail + 1) & kIndexMask;
+            return true;
+        }
+
+        /// Sets the reward link fired by every rising crossing. This allows delivering lick-triggered rewards with
+        /// the crossing interrupt latency. Passing nullptr detaches the link.
+        void SetRewardLink(RewardLink* link)
+        {
+            _link = link;
+        }
+
+        /// Returns the number of crossings discarded since the watchdog was started because the queue was full.
+        [[nodiscard]] uint32_t GetDropped() const
+        {
+            return _dropped;
+        }
+
+    private:
+        /// Stores the ADC input channel connected to the monitored pin.
+        static constexpr uint8_t kChannel = ResolveAdcChannel(kPin);
+
+        /// Stores the bitmask used to wrap queue indices.
+        static constexpr uint8_t kIndexMask = kQueueSize - 1;
+
+        /// Queues the crossing and flips the compare condition. Called by the ADC2 conversion-complete interrupt, which
+        /// only fires when the conversion result meets the compare condition.
+        static void HandleCrossing()
+        {
+            const auto value         = static_cast<uint16_t>(ADC2_R0);  // Reading the result clears the interrupt flag.
+            const uint32_t timestamp = micros();
+
+            // Fires the reward link first to minimize the lick-to-reward latency.
+            if (!_above && _link != nullptr) _link->Fire(timestamp);
+
+            // The queue is written only by the interrupt and read only by the module, so each index has a single
+            // writer. The head index is published after the entry is written, with a compiler barrier in between.
+            const uint8_t head = _head;
+            const uint8_t next = (head + 1) & kIndexMask;
+            if (next == _tail) _dropped = _dropped + 1;
+            else
+            {
+                _queue[head].timestamp = timestamp;
+                _queue[head].value     = value;
+                _queue[head].rising    = !_above;
+                __asm__ volatile("" ::: "memory");
+                _head = next;
+            }
+
+            // Waits for the opposite crossing. Rewriting HC0 restarts the continuous conversions with the new
+            // condition.
+            _above = !_above;
+            if (_above)
+            {
+                ADC2_CV = ADC_CV_CV1(_lower);
+                ADC2_GC &= ~ADC_GC_ACFGT;  // Less than CV1.
+            }
+            else
+            {
+                ADC2_CV = ADC_CV_CV1(_upper);
+                ADC2_GC |= ADC_GC_ACFGT;  // Greater than or equal to CV1.
+            }
+            ADC2_HC0 = ADC_HC_AIEN | ADC_HC_ADCH(kChannel);
+        }
+
+        /// The queue of detected crossings.
+        static inline volatile AdcCrossing _queue[kQueueSize] = {};
+
+        /// The queue index of the next crossing written by the interrupt.
+        static inline volatile uint8_t _head = 0;
+
+        /// The queue index of the next crossing read by the module.
+        static inline volatile uint8_t _tail = 0;
+
+        /// The number of crossings discarded because the queue was full.
+        static inline volatile uint32_t _dropped = 0;
+
+        /// The threshold that has to be reached for a rising crossing.
+        static inline volatile uint16_t _upper = 0;
+
+        /// The threshold the signal has to fall below for a falling crossing.
+        static inline volatile uint16_t _lower = 0;
+
+        /// The reward link fired by the rising crossings.
+        static inline RewardLink* volatile _link = nullptr;
+
+        /// Tracks whether the signal is currently above the thresholds (waiting for the falling crossing).
+        static inline volatile bool _above = false;
+
+        /// Tracks whether the watchdog is currently monitoring the pin.
+        bool _active = false;
+};
+
+#endif  //AXMC_ADC_WATCHDOG_H
@@ -2,6 +2,37 @@
  * This class is designed to interface with an analog input pin on the microcontroller. It reads the analog
  * signal from the specified pin, checks if the signal exceeds a defined threshold (default 0), and reports
  * the status to the PC.    -- WJ
+ *
+ * The module supports two acquisition modes. By default, the pin is sampled once every time the Kernel runs the
+ * CheckState command, using non-blocking conversions (see adc_frontend.h). Alternatively, the StartStream command
+ * samples the pin continuously at a fixed, hardware-timed rate (see adc_stream.h), and CheckState only drains the
+ * buffered samples. The default 1 kHz stream rate can be sustained with one message per readout. Faster streams have
+ * to be combined with batching, compression, decimation or demodulation, as otherwise the serial link falls behind and
+ * the stream buffer overruns.
+ *
+ * The CheckState command can be paced to a target service rate with the service_period parameter (see
+ * module_schedule.h). For CheckState-driven sampling, this also fixes the sampling rate.
+ *
+ * In either mode, the readouts can be reported one message per readout or packed into batch messages of up to
+ * kMaxBatchSize readouts. Each batch message is a kFifteenUint16s array laid out as: [readout count, sample interval
+ * (us), start timestamp low word, start timestamp high word, readouts...]. The start timestamp is the micros() time
+ * of the first readout in the batch. For the continuous stream, the interval is the exact sampling interval. For
+ * CheckState-driven sampling, the interval is the mean spacing of the batched readouts, as they are not sampled at
+ * a fixed rate. To keep the reconstructed timestamps accurate, the batch is closed early when a readout's spacing
+ * deviates from the spacing of the first two batched readouts by more than 1/kSpacingTolerance of it. Similarly, the
+ * batch is closed before the samples lost to a stream buffer overrun, so that no batch spans the gap.
+ *
+ * For slowly changing signals, the readouts can instead be delta-encoded into fixed-size compressed frames (see
+ * stream_codec.h). Each frame is sent as a kFifteenUint32s array, which the PC reinterprets as kDeltaFrameSize bytes.
+ * Compression takes precedence over batching.
+ *
+ * If the photometry excitation light is modulated, the module can instead demodulate the readouts on-device (see
+ * lock_in.h) and only send one amplitude and phase pair per integration window. The demodulation takes precedence
+ * over compression and batching, and ignores the signal threshold.
+ *
+ * Before being reported, the readouts can be decimated (see decimator.h). This allows oversampling the pin (for
+ * example, with the continuous stream) and only reporting the band of interest. When enabled, decimation replaces the
+ * average_pool_size readout averaging.
  */
 
  
@@ -12,6 +43,14 @@
 #include <Arduino.h>
 #include <digitalWriteFast.h>
 #include <module.h>
+#include "adc_frontend.h"
+#include "adc_stream.h"
+#include "decimator.h"
+#include "lock_in.h"
+#include "parameter_store.h"
+#include "module_schedule.h"
+#include "profiler.h"
+#include "stream_codec.h"
 
 template <const uint8_t kPin>
 class AnalogModule final : public Module 
@@ -27,12 +66,23 @@ class AnalogModule final : public Module
         enum class kCustomStatusCodes : uint8_t
         {
             kNonZero = 51,  /// The signal received by the monitored pin is above threshold (zero).
+            kOverrun = 52,  /// The continuous stream buffer was not drained in time and samples were lost.
+            kBatch   = 53,  /// A batch of consecutive readouts, at least one of which is above threshold.
+            kFrame   = 54,  /// A compressed frame of consecutive readouts, at least one of which is above threshold.
+            kCompressionStatistics = 55,  /// The number of raw and compressed bytes sent since module setup.
+            kDemodulated = 56,  /// The window start timestamp, amplitude (Q16.16) and phase (2^32 per turn).
+            kParametersRestored = 57,  /// The runtime parameters were restored from the emulated EEPROM.
+            kStoreRefused = 58,  /// The parameters were not stored, as the continuous stream is active.
         };
 
         /// Assigns meaningful names to module command byte-codes.
         enum class kModuleCommands : uint8_t
         {
-            kCheckState = 1,  ///< Checks the state of the input pin, and if necessary informs the PC of any changes.
+            kCheckState  = 1,  ///< Checks the state of the input pin, and if necessary informs the PC of any changes.
+            kStartStream = 2,  ///< Starts continuously sampling the pin every sampling_interval microseconds.
+            kStopStream  = 3,  ///< Stops continuously sampling the pin and reverts to sampling during CheckState.
+            kGetCompressionStatistics = 4,  ///< Reports the number of raw and compressed readout bytes to the PC.
+            kStoreParameters = 5,  ///< Commits the current runtime parameters to the emulated EEPROM.
         };
 
         /// Initializes the AnalogModule class by subclassing the base Module class.
@@ -45,20 +95,35 @@ class AnalogModule final : public Module
         /// reception buffer.
         bool SetCustomParameters() override
         {
+            AXMC_PROFILE_CALL(0);
+
             // Extracts the received parameters into the _custom_parameters structure of the class. If extraction fails,
             // returns false. This instructs the Kernel to execute the necessary steps to send an error message to the
             // PC.
-            return _communication.ExtractModuleParameters(_custom_parameters);
+            if (!_communication.ExtractModuleParameters(_custom_parameters)) return false;
+            ApplyParameters();
+            _schedule.Configure(_custom_parameters.service_period);
+            return true;
         }
 
         /// Executes the currently active command.
         bool RunActiveCommand() override
         {
+            AXMC_PROFILE_CALL(GetActiveCommand());
+
             // Depending on the currently active command, executes the necessary logic.
             switch (static_cast<kModuleCommands>(GetActiveCommand()))
             {
                 // CheckState
                 case kModuleCommands::kCheckState: CheckState(); return true;
+                // StartStream
+                case kModuleCommands::kStartStream: StartStream(); return true;
+                // StopStream
+                case kModuleCommands::kStopStream: StopStream(); return true;
+                // GetCompressionStatistics
+                case kModuleCommands::kGetCompressionStatistics: GetCompressionStatistics(); return true;
+                // StoreParameters
+                case kModuleCommands::kStoreParameters: StoreParameters(); return true;
                 // Unrecognized command
                 default: return false;
             }
@@ -70,9 +135,42 @@ class AnalogModule final : public Module
             // Sets pin to Input mode.
             pinModeFast(kPin, INPUT_PULLDOWN);
 
+            // Registers the pin with the ADC front-end. Fails the setup if all front-end slots are taken.
+            _adc_slot = AdcFrontend::Register(kPin);
+            if (_adc_slot == AdcFrontend::kInvalidSlot) return false;
+
             // Resets the custom_parameters structure fields to their default values. Assumes 12-bit ADC resolution.
             _custom_parameters.signal_threshold  = 30;  // Set to zero so that any photometry signal can be detected. Change this to filter out noise
-            _custom_parameters.average_pool_size = 0;    // Better to have at 0 because Teensy already does this
+            _custom_parameters.average_pool_size = 0;    // Averaging is done by the ADC hardware, see AdcFrontend
+            _custom_parameters.sampling_interval = 1000;  // 1 kHz, which the unbatched per-readout messages can sustain
+            _custom_parameters.batch_size        = 0;    // Sends each readout as a separate message
+            _custom_parameters.compression       = 0;    // Disables compression
+            _custom_parameters.excitation_frequency = 0;    // Disables demodulation
+            _custom_parameters.demodulation_window  = 1000;
+            _custom_parameters.decimation_ratio        = 0;     // Disables decimation
+            _custom_parameters.decimation_compensation = true;
+            _custom_parameters.service_period          = 0;     // Checks the pin every runtime cycle
+
+            // Ensures the continuous stream is not running and discards any partially filled batch when the module is
+            // (re)set.
+            _stream.Stop();
+            _batch_count           = 0;
+            _batch_above_threshold = false;
+            _encoder.Reset(kDeltaEncodings::kVarint);
+            _raw_bytes        = 0;
+            _compressed_bytes = 0;
+            _demodulator.Configure(0, 0);
+            _decimator.Configure(0, true);
+            _decimation_compensation = true;
+
+            // Replaces the defaults with the parameters committed to the emulated EEPROM, if they are valid, and
+            // notifies the PC that it does not need to resend them.
+            if (ParameterStore::Load(_store_address, GetModuleType(), GetModuleID(), _custom_parameters))
+            {
+                ApplyParameters();
+                SendData(static_cast<uint8_t>(kCustomStatusCodes::kParametersRestored));
+            }
+            _schedule.Configure(_custom_parameters.service_period);
 
             // Notifies the PC about the initial analog state input. Primarily, this is needed to support data source
             // time-alignment during post-processing.
@@ -93,36 +191,447 @@ class AnalogModule final : public Module
         {
                 uint16_t signal_threshold = 30;  ///< The lower boundary for signals to be reported to PC.
                 uint8_t average_pool_size = 0;    ///< The number of readouts to average into pin state value.
+                uint16_t sampling_interval = 1000;  ///< The time, in microseconds, between continuous stream samples.
+                uint8_t batch_size = 0;           ///< The number of readouts per batch message (0 or 1 to disable).
+                uint8_t compression = 0;          ///< The frame encoding: 0 to disable, 1 for varint, 2 for nibble.
+                uint16_t excitation_frequency = 0;    ///< The excitation light modulation frequency (Hz), 0 to disable.
+                uint16_t demodulation_window = 1000;  ///< The number of readouts per demodulated window.
+                uint16_t decimation_ratio = 0;        ///< The number of readouts per decimated readout (0 to disable).
+                bool decimation_compensation = true;  ///< Determines whether to compensate for the CIC passband droop.
+                uint32_t service_period = 0;          ///< The target time, in us, between checks. 0 checks every cycle.
         } PACKED_STRUCT _custom_parameters;
 
+        /// Paces the CheckState command to the service_period.
+        ModuleSchedule _schedule;
+
+        /// The number of header elements that precede the readouts in each batch message.
+        static constexpr uint8_t kBatchHeaderSize = 4;
+
+        /// The maximum number of readouts that fit into a single batch message.
+        static constexpr uint8_t kMaxBatchSize = 15 - kBatchHeaderSize;
+
+        /// Stores the batch message that is currently being filled.
+        uint16_t _batch[kBatchHeaderSize + kMaxBatchSize] = {};
+
+        /// The number of readouts currently stored in the batch.
+        uint8_t _batch_count = 0;
+
+        /// The micros() timestamp of the first readout in the batch or compressed frame.
+        uint32_t _batch_start = 0;
+
+        /// The micros() timestamp of the last readout in the batch or compressed frame.
+        uint32_t _batch_end = 0;
+
+        /// Tracks whether any readout in the current batch or compressed frame is above threshold.
+        bool _batch_above_threshold = false;
+
+        /// The spacing, in microseconds, of the first two readouts in the batch or compressed frame. Only used for the
+        /// readouts that are not sampled at a fixed rate.
+        uint32_t _batch_spacing = 0;
+
+        /// The inverse of the largest allowed relative deviation of the readout spacing from _batch_spacing.
+        static constexpr uint8_t kSpacingTolerance = 8;
+
+        /// Packs the readouts into compressed frames.
+        DeltaFrameEncoder _encoder;
+
+        /// Demodulates the readouts at the excitation frequency.
+        LockInDemodulator _demodulator;
+
+        /// Decimates the readouts before they are reported.
+        CicDecimator _decimator;
+
+        /// Tracks the compensation setting applied to the decimator.
+        bool _decimation_compensation = true;
+
+        /// The number of bytes the readouts sent in compressed frames would take if sent as raw uint16 values.
+        uint32_t _raw_bytes = 0;
+
+        /// The number of bytes taken by the sent compressed frames.
+        uint32_t _compressed_bytes = 0;
+
+        /// The maximum number of buffered samples processed by a single CheckState call. This bounds the time the
+        /// command can take when the stream falls behind, at the cost of leaving the rest for the next call.
+        static constexpr uint16_t kMaxDrainCount = 1024;
+
+        /// Continuously samples the pin when the stream is started.
+        AdcStream<kPin> _stream;
+
+        /// The AdcFrontend slot used to convert the pin readouts when the stream is not active.
+        uint8_t _adc_slot = AdcFrontend::kInvalidSlot;
+
+        /// The emulated EEPROM address of the module's parameter record.
+        uint16_t _store_address = ParameterStore::kInvalidAddress;
+
+        /// Commits the current runtime parameters to the emulated EEPROM, so that they are restored when the
+        /// microcontroller resets. Aborts the command if the EEPROM does not have enough free space. Since the flash
+        /// write delays the sampling timer interrupt, which breaks the uniform sampling interval (see
+        /// parameter_store.h), the command is also aborted, with the kStoreRefused message, while the stream is active.
+        void StoreParameters()
+        {
+            if (_stream.IsActive())
+            {
+                SendData(static_cast<uint8_t>(kCustomStatusCodes::kStoreRefused));
+                AbortCommand();
+                return;
+            }
+            if (!ParameterStore::Save(_store_address, GetModuleType(), GetModuleID(), _custom_parameters))
+            {
+                AbortCommand();
+                return;
+            }
+            CompleteCommand();
+        }
+
+        /// Applies the parameters that configure the signal processing stages.
+        void ApplyParameters()
+        {
+            // Applies the decimation parameters. Since this discards the decimator state, it is only done when the
+            // parameters change.
+            if (_custom_parameters.decimation_ratio != _decimator.GetRatio() ||
+                _custom_parameters.decimation_compensation != _decimation_compensation)
+            {
+                _decimation_compensation = _custom_parameters.decimation_compensation;
+                _decimator.Configure(_custom_parameters.decimation_ratio, _decimation_compensation);
+            }
+
+            // Applies the demodulation parameters. This restarts the current integration window.
+            _demodulator.Configure(
+                _custom_parameters.excitation_frequency,
+                _custom_parameters.excitation_frequency == 0 ? 0 : _custom_parameters.demodulation_window
+            );
+        }
+
+        /// Starts continuously sampling the input pin at the requested fixed rate.
+        void StartStream()
+        {
+            // Sends out the readouts batched or compressed before the stream was started, as their spacing differs
+            // from the stream's sampling interval.
+            SendBatch(0);
+            SendFrame(0);
+
+            // Aborts the command if the interval is invalid or the sampling timer could not be allocated.
+            if (!_stream.Start(_custom_parameters.sampling_interval))
+            {
+                AbortCommand();
+                return;
+            }
+            CompleteCommand();
+        }
+
+        /// Stops continuously sampling the input pin.
+        void StopStream()
+        {
+            _stream.Stop();
+
+            // Drains the samples acquired before the stream was stopped and sends out the partially filled batch or
+            // compressed frame.
+            DrainStream();
+            SendBatch(_stream.GetInterval());
+            SendFrame(_stream.GetInterval());
+
+            CompleteCommand();
+        }
+
+        /// Sends the number of raw and compressed readout bytes to the PC. The ratio of the two values is the achieved
+        /// compression ratio.
+        void GetCompressionStatistics()
+        {
+            const uint32_t statistics[2] = {_raw_bytes, _compressed_bytes};
+            SendData(
+                static_cast<uint8_t>(kCustomStatusCodes::kCompressionStatistics),
+                kPrototypes::kTwoUint32s,
+                statistics
+            );
+            CompleteCommand();
+        }
+
         /// Checks the signal received by the input pin and, if necessary, reports it to the PC.
         void CheckState()
         {
-            // Evaluates the state of the pin. Averages the requested number of readouts to produce the final
-            // analog signal value. Note, since we statically configure the controller to use 10-14 bit ADC resolution,
-            // this value should not use the full range of the 16-bit uint variable.
-            const uint16_t signal = AnalogRead(kPin, _custom_parameters.average_pool_size);
+            // Skips the check if the pin is not due for service yet.
+            if (!_schedule.IsDue())
+            {
+                CompleteCommand();
+                return;
+            }
 
-            // Prevents reporting signals that are below threshold (default is zero).
-            if (signal <= _custom_parameters.signal_threshold)
+            // If the continuous stream is active, the readouts are already waiting in the stream buffer.
+            if (_stream.IsActive())
             {
+                DrainStream();
                 CompleteCommand();
                 return;
             }
 
-            // If the signal is above the threshold, sends it to the PC
-            if (signal >= _custom_parameters.signal_threshold)
+            // Collects the readout converted since the previous check and immediately requests the next one, so that
+            // the conversion runs while the Kernel services other modules. The ADC hardware averages the requested
+            // number of readouts to produce the final analog signal value, unless the readouts are decimated, which
+            // already filters them. Note, since we statically configure the controller to use 10-14 bit ADC
+            // resolution, this value should not use the full range of the 16-bit uint variable.
+            // The readout is timestamped with the time its conversion was started, which matches the timestamp of the
+            // readout of the paired pin, if any.
+            uint16_t signal;
+            uint32_t timestamp;
+            const bool converted = AdcFrontend::Read(_adc_slot, signal, timestamp);
+            AdcFrontend::Request(_adc_slot, _decimator.IsEnabled() ? 0 : _custom_parameters.average_pool_size);
+            if (converted) ProcessSignal(signal, timestamp, 0);
+
+            // Completes command execution
+            CompleteCommand();
+        }
+
+        /// Processes the samples accumulated by the continuous stream since the last call.
+        void DrainStream()
+        {
+            // Notifies the PC if the buffer overflowed, as the sample stream is no longer contiguous.
+            const uint32_t lost = _stream.ResolveOverrun();
+            if (lost != 0)
             {
+                // Closes the partially filled batch or compressed frame and discards the decimator state, so that no
+                // message spans the lost samples.
+                SendBatch(_stream.GetInterval());
+                SendFrame(_stream.GetInterval());
+                _decimator.Configure(_decimator.GetRatio(), _decimation_compensation);
+
+                SendData(
+                    static_cast<uint8_t>(kCustomStatusCodes::kOverrun),
+                    kPrototypes::kOneUint32,
+                    lost
+                );
+            }
+
+            // Resolves the timestamp of each readout from its position in the stream, as the samples are acquired at a
+            // fixed rate. The start time is the trigger time of the first sample, so sample i was triggered i intervals
+            // later.
+            const uint16_t interval = _stream.GetInterval();
+            uint32_t timestamp      = _stream.GetStartTime() + _stream.GetSampleIndex() * interval;
+            uint16_t signal;
+            for (uint16_t i = 0; i < kMaxDrainCount && _stream.Read(signal); ++i)
+            {
+                ProcessSignal(signal, timestamp, interval);
+                timestamp += interval;
+            }
+        }
+
+        /**
+         * @brief Decimates the signal, if requested, and reports the resultant signal to the PC.
+         *
+         * @param signal the readout to process.
+         * @param timestamp the micros() time at which the readout was acquired.
+         * @param interval the fixed sampling interval, in microseconds, or 0 if the readouts are not sampled at a fixed
+         * rate.
+         */
+        void ProcessSignal(const uint16_t signal, const uint32_t timestamp, const uint16_t interval)
+        {
+            if (!_decimator.IsEnabled())
+            {
+                ReportSignal(signal, timestamp, interval);
+                return;
+            }
+
+            // Decimated readouts are timestamped with the time of the readout that completed them. The output interval
+            // saturates at the largest value the message headers can store.
+            uint16_t decimated;
+            if (!_decimator.Add(signal, decimated)) return;
+            const uint32_t decimated_interval = static_cast<uint32_t>(interval) * _decimator.GetRatio();
+            ReportSignal(
+                decimated,
+                timestamp,
+                decimated_interval > UINT16_MAX ? UINT16_MAX : static_cast<uint16_t>(decimated_interval)
+            );
+        }
+
+        /**
+         * @brief Reports the signal to the PC, either as a separate message or as part of a batch.
+         *
+         * @param signal the readout to report.
+         * @param timestamp the micros() time at which the readout was acquired.
+         * @param interval the fixed sampling interval, in microseconds, or 0 if the readouts are not sampled at a fixed
+         * rate.
+         */
+        void ReportSignal(const uint16_t signal, const uint32_t timestamp, const uint16_t interval)
+        {
+            if (_demodulator.IsEnabled())
+            {
+                DemodulateSignal(signal, timestamp);
+                return;
+            }
+
+            if (_custom_parameters.compression != 0)
+            {
+                CompressSignal(signal, timestamp, interval);
+                return;
+            }
+
+            // Sends each readout separately unless batching is enabled.
+            if (_custom_parameters.batch_size <= 1)
+            {
+                // Prevents reporting signals that are below threshold (default is zero).
+                if (signal <= _custom_parameters.signal_threshold) return;
+
                 // Sends the detected signal to the PC.
                 SendData(
                     static_cast<uint8_t>(kCustomStatusCodes::kNonZero),
                     kPrototypes::kOneUint16,
                     signal
                 );
+                return;
             }
 
-            // Completes command execution
-            CompleteCommand();
+            // Closes the batch if the readout breaks its regular spacing.
+            if (interval == 0 && BreaksSpacing(timestamp, _batch_count)) SendBatch(0);
+
+            if (_batch_count == 0) _batch_start = timestamp;
+            _batch_end = timestamp;
+            _batch[kBatchHeaderSize + _batch_count++] = signal;
+            if (signal > _custom_parameters.signal_threshold) _batch_above_threshold = true;
+
+            // Sends the batch once it reaches the requested size (or the largest size that fits into the message).
+            if (_batch_count >= _custom_parameters.batch_size || _batch_count >= kMaxBatchSize) SendBatch(interval);
+        }
+
+        /// Adds the signal to the demodulation window and, if the window is complete, sends its amplitude and phase to
+        /// the PC.
+        void DemodulateSignal(const uint16_t signal, const uint32_t timestamp)
+        {
+            if (!_demodulator.Add(signal, timestamp)) return;
+
+            const uint32_t result[3] = {_demodulator.GetStart(), _demodulator.GetAmplitude(), _demodulator.GetPhase()};
+            SendData(
+                static_cast<uint8_t>(kCustomStatusCodes::kDemodulated),
+                kPrototypes::kThreeUint32s,
+                result
+            );
+        }
+
+        /// Adds the signal to the compressed frame, sending out the frame first if it is full.
+        void CompressSignal(const uint16_t signal, const uint32_t timestamp, const uint16_t interval)
+        {
+            // Closes the frame if the readout breaks its regular spacing.
+            if (interval == 0 && BreaksSpacing(timestamp, _encoder.GetCount())) SendFrame(0);
+
+            // Applies the currently requested encoding when starting a new frame.
+            if (_encoder.GetCount() == 0) _encoder.Reset(ResolveEncoding());
+
+            if (!_encoder.Append(signal))
+            {
+                SendFrame(interval);
+                _encoder.Append(signal);
+            }
+
+            if (_encoder.GetCount() == 1) _batch_start = timestamp;
+            _batch_end = timestamp;
+            if (signal > _custom_parameters.signal_threshold) _batch_above_threshold = true;
+        }
+
+        /**
+         * @brief Determines whether the readout breaks the regular spacing of the current batch or compressed frame.
+         *
+         * Only used for the readouts that are not sampled at a fixed rate. The spacing of the first two readouts is
+         * used as the reference.
+         *
+         * @param timestamp the micros() time at which the readout was acquired.
+         * @param count the number of readouts in the current batch or compressed frame.
+         * @returns true if the batch or frame has to be closed before adding the readout.
+         */
+        bool BreaksSpacing(const uint32_t timestamp, const uint8_t count)
+        {
+            if (count == 0) return false;
+
+            // The spacing has to fit into the uint16 interval field of the message header.
+            const uint32_t spacing = timestamp - _batch_end;
+            if (spacing > UINT16_MAX) return true;
+
+            if (count == 1)
+            {
+                _batch_spacing = spacing;
+                return false;
+            }
+
+            // Allows 1 us of extra deviation to account for the micros() resolution.
+            const uint32_t deviation = spacing > _batch_spacing ? spacing - _batch_spacing : _batch_spacing - spacing;
+            return deviation > _batch_spacing / kSpacingTolerance + 1;
+        }
+
+        /// Resolves the frame encoding requested by the compression parameter.
+        [[nodiscard]] kDeltaEncodings ResolveEncoding() const
+        {
+            return _custom_parameters.compression == static_cast<uint8_t>(kDeltaEncodings::kNibble)
+                       ? kDeltaEncodings::kNibble
+                       : kDeltaEncodings::kVarint;
+        }
+
+        /**
+         * @brief Sends the currently accumulated compressed frame to the PC and starts a new frame.
+         *
+         * Similar to batches, frames that do not contain any above-threshold readouts are discarded.
+         *
+         * @param interval the fixed sampling interval, in microseconds, or 0 if the readouts are not sampled at a fixed
+         * rate.
+         */
+        void SendFrame(uint16_t interval)
+        {
+            const uint8_t count = _encoder.GetCount();
+            if (count != 0 && _batch_above_threshold)
+            {
+                // For readouts that are not sampled at a fixed rate, uses the rounded mean spacing between readouts.
+                if (interval == 0 && count > 1)
+                {
+                    interval = static_cast<uint16_t>((_batch_end - _batch_start + (count - 1) / 2) / (count - 1));
+                }
+
+                SendData(
+                    static_cast<uint8_t>(kCustomStatusCodes::kFrame),
+                    kPrototypes::kFifteenUint32s,
+                    _encoder.Finalize(_batch_start, interval)
+                );
+                _raw_bytes += count * sizeof(uint16_t);
+                _compressed_bytes += kDeltaFrameSize;
+            }
+
+            _encoder.Reset(ResolveEncoding());
+            _batch_above_threshold = false;
+        }
+
+        /**
+         * @brief Sends the currently accumulated batch to the PC and resets the batch.
+         *
+         * Batches that do not contain any above-threshold readouts are discarded, which preserves the traffic-limiting
+         * role of the threshold while keeping the readouts inside each sent batch contiguous.
+         *
+         * @param interval the fixed sampling interval, in microseconds, or 0 if the readouts are not sampled at a fixed
+         * rate.
+         */
+        void SendBatch(uint16_t interval)
+        {
+            if (_batch_count == 0) return;
+
+            if (_batch_above_threshold)
+            {
+                // For readouts that are not sampled at a fixed rate, uses the rounded mean spacing between readouts.
+                if (interval == 0 && _batch_count > 1)
+                {
+                    const uint32_t gaps = _batch_count - 1;
+                    interval            = static_cast<uint16_t>((_batch_end - _batch_start + gaps / 2) / gaps);
+                }
+
+                // Zeroes out the readout slots left over from the previous batch.
+                for (uint8_t i = _batch_count; i < kMaxBatchSize; ++i) _batch[kBatchHeaderSize + i] = 0;
+
+                _batch[0] = _batch_count;
+                _batch[1] = interval;
+                _batch[2] = static_cast<uint16_t>(_batch_start & 0xFFFF);
+                _batch[3] = static_cast<uint16_t>(_batch_start >> 16);
+                SendData(
+                    static_cast<uint8_t>(kCustomStatusCodes::kBatch),
+                    kPrototypes::kFifteenUint16s,
+                    _batch
+                );
+            }
+
+            _batch_count           = 0;
+            _batch_above_threshold = false;
         }
 };
 #endif  //ANALOG_MODULE_WJ
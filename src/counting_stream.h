@@ -0,0 +1,108 @@
+/**
+ * @file
+ * @brief The header-only file for the CountingStream class. This class allows measuring the outgoing serial traffic
+ * without modifying the Communication class, which is provided by the ataraxis-micro-controller library.
+ *
+ * The stream wraps the serial port passed to the Communication class and forwards all calls to it. Along the way, it
+ * counts the transmitted bytes and messages, the writes that had to wait for the transmission buffer to drain
+ * (stalls) and the writes that the port did not fully accept (drops). The counters are read and reset by the
+ * TelemetryModule (see telemetry_module.h).
+ *
+ * @note The transport layer writes each message with a single buffered write() call, so each buffered call is counted
+ * as one message.
+ *
+ * @section cnt_str_dependencies Dependencies:
+ * - Arduino.h for Arduino platform functions and macros and cross-compatibility with Arduino IDE (to an extent).
+ */
+
+#ifndef AXMC_COUNTING_STREAM_H
+#define AXMC_COUNTING_STREAM_H
+
+#include <cstdint>
+#include <Arduino.h>
+
+/// Stores the outgoing traffic counters of the CountingStream class.
+struct TrafficCounters
+{
+        uint32_t bytes    = 0;  ///< The number of bytes accepted by the port.
+        uint32_t messages = 0;  ///< The number of messages written to the port.
+        uint32_t stalls   = 0;  ///< The number of messages that did not fit into the free transmission buffer space.
+        uint32_t drops    = 0;  ///< The number of messages that the port did not fully accept.
+};
+
+/**
+ * @brief Forwards all calls to the wrapped stream and counts the outgoing traffic.
+ *
+ * Counting adds a single availableForWrite() query and a few increments to each buffered write.
+ */
+class CountingStream final : public Stream
+{
+    public:
+        /// Wraps the stream.
+        explicit CountingStream(Stream& stream) : _stream(stream)
+        {}
+
+        size_t write(const uint8_t byte) override
+        {
+            const size_t written = _stream.write(byte);
+            _counters.bytes += written;
+            return written;
+        }
+
+        size_t write(const uint8_t* buffer, const size_t size) override
+        {
+            // The write has to wait for the port to transmit the previously buffered data if the message does not fit
+            // into the free buffer space.
+            if (static_cast<size_t>(_stream.availableForWrite()) < size) ++_counters.stalls;
+
+            const size_t written = _stream.write(buffer, size);
+            if (written < size) ++_counters.drops;
+            _counters.bytes += written;
+            ++_counters.messages;
+            return written;
+        }
+
+        // Keeps the convenience overloads inherited from the Print class visible.
+        using Stream::write;
+
+        int available() override
+        {
+            return _stream.available();
+        }
+
+        int read() override
+        {
+            return _stream.read();
+        }
+
+        int peek() override
+        {
+            return _stream.peek();
+        }
+
+        void flush() override
+        {
+            _stream.flush();
+        }
+
+        int availableForWrite() override
+        {
+            return _stream.availableForWrite();
+        }
+
+        /// Copies the traffic counters accumulated since the previous call and resets them.
+        void TakeCounters(TrafficCounters& counters)
+        {
+            counters  = _counters;
+            _counters = TrafficCounters();
+        }
+
+    private:
+        /// The wrapped stream.
+        Stream& _stream;
+
+        /// The traffic counters accumulated since the previous TakeCounters() call.
+        TrafficCounters _counters;
+};
+
+#endif  //AXMC_COUNTING_STREAM_H
@@ -0,0 +1,225 @@
+/**
+ * @file
+ * @brief The header-only file for the LickArrayModule class. This class allows interfacing with multiple custom
+ * conductive lick sensors (for example, a multi-spout array) through a single module.
+ *
+ * This class applies the same detection logic as the LickModule class to every managed sensor, but scans all sensors
+ * during a single command and reports all sensors that changed during the scan in a single message. This reduces the
+ * communication overhead for rigs with many spouts to one message per scan instead of one message per sensor.
+ *
+ * @section lck_arr_mod_dependencies Dependencies:
+ * - Arduino.h for Arduino platform functions and macros and cross-compatibility with Arduino IDE (to an extent).
+ * - digitalWriteFast.h for fast digital pin manipulation methods.
+ * - module.h for the shared Module class API access (integrates the custom module into runtime flow).
+ * - adc_frontend.h for non-blocking, hardware-averaged analog readouts.
+ * - lick_scan.h for packing the sensor changes into the scan message.
+ * - profiler.h for the opt-in execution time profiling of the module commands.
+ * - module_schedule.h for servicing the sensors at a target rate.
+ */
+
+#ifndef AXMC_LICK_ARRAY_MODULE_H
+#define AXMC_LICK_ARRAY_MODULE_H
+
+#include <cstdint>
+#include <Arduino.h>
+#include <digitalWriteFast.h>
+#include <module.h>
+#include "adc_frontend.h"
+#include "lick_scan.h"
+#include "profiler.h"
+#include "module_schedule.h"
+
+/**
+ * @brief Monitors the states of multiple custom conductive lick sensors for significant state changes and notifies the
+ * PC when such changes occur.
+ *
+ * Each scan collects the readouts converted since the previous scan for all sensors and requests the next conversions.
+ * The sensors that changed are reported in a single kChanged message. The message is a uint16 array that starts with
+ * the bitmask of changed sensors (bit i corresponds to the i-th pin in the template parameter list), followed by one
+ * value per sensor. The values of the changed sensors follow the LickModule conventions: the readout if it is above
+ * the signal threshold and 0 otherwise. The values of the unchanged sensors are set to 0 and should be ignored. See
+ * lick_scan.h for the change detection and packing logic, which is verified by test/test_lick_scan.
+ *
+ * @note All sensors share the same detection parameters. The per-sensor detection state is stored as a
+ * structure-of-arrays to keep the scan compact.
+ *
+ * @tparam kPins the analog pins whose states will be monitored to detect licks. Supports up to 8 pins.
+ */
+template <const uint8_t... kPins>
+class LickArrayModule final : public Module
+{
+        /// The number of managed sensors.
+        static constexpr uint8_t kCount = sizeof...(kPins);
+
+        // Ensures that the number of sensors fits into the ADC front-end and the changed sensor bitmask.
+        static_assert(
+            kCount >= 1 && kCount <= 8,
+            "LickArrayModule supports between 1 and 8 pins. Split larger sensor arrays across multiple instances."
+        );
+
+        // Ensures that none of the pins interfere with the LED pin.
+        static_assert(
+            ((kPins != LED_BUILTIN) && ...),
+            "LED-connected pin is reserved for LED manipulation. Select a different pin for LickArrayModule instance."
+        );
+
+        // Ensures that all pins can be converted by the ADC front-end.
+        static_assert(
+            ((ResolveAdcChannel(kPins) != 255) && ...),
+            "LickArrayModule pins have to be Teensy 4.0 analog pins available to ADC1 (14 through 23)."
+        );
+
+    public:
+
+        /// Assigns meaningful names to byte status-codes used to communicate module events to the PC. Note,
+        /// this enumeration has to use codes 51 through 255 to avoid interfering with shared kCoreStatusCodes
+        /// enumeration inherited from base Module class.
+        enum class kCustomStatusCodes : uint8_t
+        {
+            kChanged = 51,  /// The signals received by one or more monitored pins have significantly changed.
+        };
+
+        /// Assigns meaningful names to module command byte-codes.
+        enum class kModuleCommands : uint8_t
+        {
+            kCheckState = 1,  ///< Scans all sensors, and if necessary informs the PC of any changes.
+        };
+
+        /// Initializes the LickArrayModule class by subclassing the base Module class.
+        LickArrayModule(const uint8_t module_type, const uint8_t module_id, Communication& communication) :
+            Module(module_type, module_id, communication)
+        {}
+
+        /// Overwrites the custom_parameters structure memory with the data extracted from the Communication
+        /// reception buffer.
+        bool SetCustomParameters() override
+        {
+            AXMC_PROFILE_CALL(0);
+
+            // Extracts the received parameters into the _custom_parameters structure of the class. If extraction fails,
+            // returns false. This instructs the Kernel to execute the necessary steps to send an error message to the
+            // PC.
+            if (!_communication.ExtractModuleParameters(_custom_parameters)) return false;
+            _schedule.Configure(_custom_parameters.service_period);
+            return true;
+        }
+
+        /// Executes the currently active command.
+        bool RunActiveCommand() override
+        {
+            AXMC_PROFILE_CALL(GetActiveCommand());
+
+            // Depending on the currently active command, executes the necessary logic.
+            switch (static_cast<kModuleCommands>(GetActiveCommand()))
+            {
+                // CheckState
+                case kModuleCommands::kCheckState: CheckState(); return true;
+                // Unrecognized command
+                default: return false;
+            }
+        }
+
+        /// Sets up module hardware parameters.
+        bool SetupModule() override
+        {
+            // Sets all pins to Input mode and registers them with the ADC front-end. Fails the setup if the front-end
+            // does not have enough free slots.
+            for (uint8_t i = 0; i < kCount; ++i)
+            {
+                pinModeFast(kPinArray[i], INPUT_PULLDOWN);
+                _adc_slots[i] = AdcFrontend::Register(kPinArray[i]);
+                if (_adc_slots[i] == AdcFrontend::kInvalidSlot) return false;
+            }
+            _scan.Reset();  // A zero-message is sent at class initialization.
+
+            // Resets the custom_parameters structure fields to their default values. Assumes 12-bit ADC resolution.
+            _custom_parameters.signal_threshold  = 200;  // Ideally should be just high enough to filter out noise
+            _custom_parameters.delta_threshold   = 180;  // Ideally should be at least half of the minimal threshold
+            _custom_parameters.average_pool_size = 0;    // Averaging is done by the ADC hardware, see AdcFrontend
+            _custom_parameters.service_period    = 0;    // Scans the sensors every runtime cycle
+            _schedule.Configure(_custom_parameters.service_period);
+
+            // Notifies the PC about the initial state of all sensors. Primarily, this is needed to support data source
+            // time-alignment during post-processing.
+            SendData(static_cast<uint8_t>(kCustomStatusCodes::kChanged), kPrototype, Scan::GetInitialMessage());
+
+            return true;
+        }
+
+        ~LickArrayModule() override = default;
+
+    private:
+        /// Stores custom addressable runtime parameters of the module.
+        struct CustomRuntimeParameters
+        {
+                uint16_t signal_threshold = 200;  ///< The lower boundary for signals to be reported to PC.
+                uint16_t delta_threshold  = 180;  ///< The minimum difference between checks to be reported to PC.
+                uint8_t average_pool_size = 0;    ///< The number of readouts to average into pin state value.
+                uint32_t service_period   = 0;    ///< The target time, in us, between scans. 0 scans every cycle.
+        } PACKED_STRUCT _custom_parameters;
+
+        /// Paces the CheckState command to the service_period.
+        ModuleSchedule _schedule;
+
+        /// Stores the monitored pins in the order they were provided as template parameters.
+        static constexpr uint8_t kPinArray[kCount] = {kPins...};
+
+        /// The type of the sensor change tracker.
+        using Scan = LickScan<kCount>;
+
+        /// Resolves the message prototype that fits the changed sensor bitmask followed by one value per sensor.
+        static constexpr kPrototypes kPrototype = []
+        {
+            constexpr kPrototypes kTable[] = {
+                kPrototypes::kTwoUint16s,
+                kPrototypes::kThreeUint16s,
+                kPrototypes::kFourUint16s,
+                kPrototypes::kFiveUint16s,
+                kPrototypes::kSixUint16s,
+                kPrototypes::kSevenUint16s,
+                kPrototypes::kEightUint16s,
+                kPrototypes::kNineUint16s,
+            };
+            return kTable[Scan::kMessageSize - 2];
+        }();
+
+        /// The AdcFrontend slot used to convert the readouts of each sensor.
+        uint8_t _adc_slots[kCount] = {};
+
+        /// Tracks the changes of all sensors and packs them into the scan message.
+        Scan _scan;
+
+        /// Scans all sensors and, if necessary, reports the changed sensors to the PC.
+        void CheckState()
+        {
+            // Skips the scan if the sensors are not due for service yet.
+            if (!_schedule.IsDue())
+            {
+                CompleteCommand();
+                return;
+            }
+
+            _scan.Begin();
+            for (uint8_t i = 0; i < kCount; ++i)
+            {
+                // Collects the readout converted since the previous scan and immediately requests the next one.
+                uint16_t signal;
+                const bool converted = AdcFrontend::Read(_adc_slots[i], signal);
+                AdcFrontend::Request(_adc_slots[i], _custom_parameters.average_pool_size);
+                if (converted)
+                {
+                    _scan.Add(i, signal, _custom_parameters.signal_threshold, _custom_parameters.delta_threshold);
+                }
+            }
+
+            if (_scan.HasChanges())
+            {
+                SendData(static_cast<uint8_t>(kCustomStatusCodes::kChanged), kPrototype, _scan.GetMessage());
+            }
+
+            // Completes command execution
+            CompleteCommand();
+        }
+};
+
+#endif  //AXMC_LICK_ARRAY_MODULE_H
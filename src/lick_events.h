@@ -0,0 +1,191 @@
+/**
+ * @file
+ * @brief The header-only file for the LickEventDetector class. This class allows converting the lick sensor signal
+ * into discrete lick events, so that each lick is reported to the PC as a single record.
+ *
+ * The detector runs a debounced state machine with hysteresis. A lick starts when the signal reaches the upper
+ * threshold and ends when the signal stays below the lower threshold for the debounce period. Brief contact breaks
+ * (for example, tongue bounces) that are shorter than the debounce period are merged into the ongoing lick.
+ *
+ * @note This file only depends on the standard library, so that it can be compiled and tested on the host-PC.
+ */
+
+#ifndef AXMC_LICK_EVENTS_H
+#define AXMC_LICK_EVENTS_H
+
+#include <cstdint>
+
+/// Stores a single lick detected by the LickEventDetector class.
+struct LickEvent
+{
+        uint32_t onset    = 0;  ///< The micros() time at which the signal reached the upper threshold.
+        uint32_t duration = 0;  ///< The time, in microseconds, between the onset and the last below-threshold crossing.
+        uint32_t peak     = 0;  ///< The largest signal value observed during the lick.
+        uint32_t interval = 0;  ///< The time, in microseconds, since the onset of the previous lick. 0 for first lick.
+};
+
+/**
+ * @brief Extracts the onset, duration, peak amplitude and inter-lick interval of each lick from the timestamped sensor
+ * signal.
+ *
+ * The detector accepts either individual readouts (Add) or hardware-detected threshold crossings (AddCrossing). The
+ * lick is only completed once the debounce period has elapsed after the offset, so the owner has to periodically call
+ * Poll() to finalize the licks when no new samples arrive.
+ */
+class LickEventDetector
+{
+    public:
+        /**
+         * @brief Configures the detector and discards its state.
+         *
+         * @param upper the threshold that the signal has to reach for the lick to start.
+         * @param lower the threshold the signal has to fall below for the lick to end.
+         * @param debounce the time, in microseconds, the signal has to stay below the lower threshold for the lick to
+         * end.
+         */
+        void Configure(const uint16_t upper, const uint16_t lower, const uint32_t debounce)
+        {
+            _upper        = upper;
+            _lower        = lower > upper ? upper : lower;
+            _debounce     = debounce;
+            _state        = kStates::kIdle;
+            _has_previous = false;
+            _started      = false;
+        }
+
+        /**
+         * @brief Adds the sensor readout to the detector.
+         *
+         * @param value the sensor readout.
+         * @param timestamp the micros() time at which the readout was converted.
+         * @returns true if the readout completed a lick, which can then be retrieved with GetEvent().
+         */
+        bool Add(const uint16_t value, const uint32_t timestamp)
+        {
+            // Finalizes the lick whose debounce period elapsed before this readout. The readout can then start the
+            // next lick, which is reported on a later call.
+            const bool completed = Poll(timestamp);
+
+            if (value >= _upper) Rise(value, timestamp);
+            else if (value < _lower) Fall(timestamp);
+            else if (_state != kStates::kIdle && value > _peak) _peak = value;
+
+            return completed;
+        }
+
+        /**
+         * @brief Adds the hardware-detected threshold crossing to the detector.
+         *
+         * @param rising determines whether the signal crossed the upper (true) or the lower threshold.
+         * @param value the readout that triggered the crossing. For rising crossings this is the only known signal
+         * value of the lick, so it is reported as the peak unless the contact bounces.
+         * @param timestamp the micros() time at which the crossing was detected.
+         * @returns true if the crossing completed a lick, which can then be retrieved with GetEvent().
+         */
+        bool AddCrossing(const bool rising, const uint16_t value, const uint32_t timestamp)
+        {
+            const bool completed = Poll(timestamp);
+            if (rising) Rise(value, timestamp);
+            else Fall(timestamp);
+            return completed;
+        }
+
+        /**
+         * @brief Completes the lick if the signal has stayed below the lower threshold for the debounce period.
+         *
+         * @param now the current micros() time.
+         * @returns true if the lick was completed, which can then be retrieved with GetEvent().
+         */
+        bool Poll(const uint32_t now)
+        {
+            if (_state != kStates::kReleasing || now - _offset < _debounce) return false;
+
+            _event.onset    = _onset;
+            _event.duration = _offset - _onset;
+            _event.peak     = _peak;
+            _event.interval = _has_previous ? _onset - _previous_onset : 0;
+            _previous_onset = _onset;
+            _has_previous   = true;
+            _state          = kStates::kIdle;
+            return true;
+        }
+
+        /// Returns true if a lick has started since the previous call of this method.
+        bool TakeOnset()
+        {
+            const bool started = _started;
+            _started           = false;
+            return started;
+        }
+
+        /// Returns the most recently completed lick.
+        [[nodiscard]] const LickEvent& GetEvent() const
+        {
+            return _event;
+        }
+
+    private:
+        /// Defines the states of the lick detection state machine.
+        enum class kStates : uint8_t
+        {
+            kIdle      = 0,  ///< There is no contact.
+            kContact   = 1,  ///< The signal is at or above the lower threshold after reaching the upper threshold.
+            kReleasing = 2,  ///< The signal fell below the lower threshold and the debounce period is running.
+        };
+
+        /// Processes the signal at or above the upper threshold.
+        void Rise(const uint16_t value, const uint32_t timestamp)
+        {
+            if (_state == kStates::kIdle)
+            {
+                _onset   = timestamp;
+                _peak    = value;
+                _started = true;
+            }
+            else if (value > _peak) _peak = value;
+            _state = kStates::kContact;  // Returning above the threshold during the debounce period resumes the lick.
+        }
+
+        /// Processes the signal below the lower threshold.
+        void Fall(const uint32_t timestamp)
+        {
+            if (_state != kStates::kContact) return;
+            _offset = timestamp;
+            _state  = kStates::kReleasing;
+        }
+
+        /// The most recently completed lick.
+        LickEvent _event;
+
+        /// The onset time of the ongoing lick.
+        uint32_t _onset = 0;
+
+        /// The time the signal fell below the lower threshold during the ongoing lick.
+        uint32_t _offset = 0;
+
+        /// The onset time of the previous completed lick.
+        uint32_t _previous_onset = 0;
+
+        /// The time the signal has to stay below the lower threshold to end the lick.
+        uint32_t _debounce = 0;
+
+        /// The largest signal value of the ongoing lick.
+        uint16_t _peak = 0;
+
+        /// The threshold that the signal has to reach for the lick to start.
+        uint16_t _upper = 0;
+
+        /// The threshold the signal has to fall below for the lick to end.
+        uint16_t _lower = 0;
+
+        /// The current state of the detector.
+        kStates _state = kStates::kIdle;
+
+        /// Tracks whether the detector has completed at least one lick since it was configured.
+        bool _has_previous = false;
+
+        /// Tracks whether a lick has started since the onset was last taken.
+        bool _started = false;
+};
+
+#endif  //AXMC_LICK_EVENTS_H
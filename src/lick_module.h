@@ -12,6 +12,13 @@
  * - digitalWriteFast.h for fast digital pin manipulation methods.
  * - module.h for the shared Module class API access (integrates the custom module into runtime flow).
  * - shared_assets.h for globally shared static message byte-codes and parameter structures.
+ * - adc_frontend.h for non-blocking, hardware-averaged analog readouts.
+ * - adc_watchdog.h for interrupt-driven lick detection using the ADC hardware compare function.
+ * - lick_events.h for on-device lick event extraction.
+ * - reward_link.h for the lick-triggered rewards delivered without the PC involvement.
+ * - parameter_store.h for restoring the runtime parameters committed to the emulated EEPROM.
+ * - module_schedule.h for servicing the sensor at a target rate.
+ * - profiler.h for the opt-in execution time profiling of the module commands.
  */
 
 #ifndef AXMC_LICK_MODULE_H
@@ -21,6 +28,13 @@
 #include <Arduino.h>
 #include <digitalWriteFast.h>
 #include <module.h>
+#include "adc_frontend.h"
+#include "adc_watchdog.h"
+#include "lick_events.h"
+#include "reward_link.h"
+#include "parameter_store.h"
+#include "module_schedule.h"
+#include "profiler.h"
 
 /**
  * @brief Monitors the state of a custom conductive lick sensor for significant state changes and notifies the PC when
@@ -32,6 +46,31 @@
  * detects a positive change in voltage across the sensor. The detection threshold can be configured to distinguish
  * between dry and wet touch, which is used to separate limb contacts from tongue contacts.
  *
+ * By default, the module converts the sensor signal every time the Kernel runs the CheckState command and compares it
+ * to the thresholds in software. Alternatively, the StartWatchdog command hands the threshold comparison to the ADC2
+ * hardware compare function (see adc_watchdog.h). In this mode, the CPU is only involved when the signal crosses the
+ * signal_threshold (lick onset) or falls below signal_threshold - delta_threshold (lick offset), and CheckState only
+ * forwards the timestamped crossings to the PC.
+ *
+ * @attention The watchdog, the AnalogModule continuous stream (see adc_stream.h) and the paired pin conversions (see
+ * adc_frontend.h) share ADC2. The watchdog and the stream are mutually exclusive: only one of them, and only one
+ * sensor's watchdog, can hold ADC2 at a time. If ADC2 is held, StartWatchdog reports the kWatchdogUnavailable message
+ * and aborts. The paired conversions yield ADC2 to either of them: while it is held, the paired pins are converted one
+ * after another by ADC1 and no longer share a timestamp.
+ *
+ * If the event_mode parameter is enabled, the module does not report individual signal changes. Instead, it runs the
+ * signal (or the hardware-detected crossings) through a debounced state machine and sends a single kLick message per
+ * lick that contains the lick onset time, contact duration, peak signal amplitude and the interval since the previous
+ * lick onset (see lick_events.h). The lick ends when the signal stays below signal_threshold - delta_threshold for the
+ * debounce_duration.
+ *
+ * The module can also deliver lick-triggered rewards without waiting for the PC. The valve is linked to the sensor by
+ * the runtime setup code (see LinkValve()) and the PC arms the link with the ArmReward command. The reward is then
+ * delivered on the first qualifying lick onset, and the module reports it with the kRewarded message afterwards. When
+ * the watchdog is active, the reward is delivered directly from the crossing interrupt, which keeps the lick-to-valve
+ * latency within a few microseconds. Otherwise, the reward is delivered when CheckState evaluates the readout, so the
+ * latency depends on how often the PC runs CheckState.
+ *
  * @note This class was calibrated to work for and tested on C57BL6J Wild-type and transgenic mice.
  *
  * @tparam kPin the analog pin whose state will be monitored to detect licks.
@@ -45,6 +84,12 @@ class LickModule final : public Module
             "LED-connected pin is reserved for LED manipulation. Select a different pin for LickModule instance."
         );
 
+        // Ensures that the pin can be converted by the ADC front-end.
+        static_assert(
+            ResolveAdcChannel(kPin) != 255,
+            "LickModule pin has to be one of the Teensy 4.0 analog pins available to ADC1 (14 through 23)."
+        );
+
     public:
 
         /// Assigns meaningful names to byte status-codes used to communicate module events to the PC. Note,
@@ -53,12 +98,23 @@ class LickModule final : public Module
         enum class kCustomStatusCodes : uint8_t
         {
             kChanged = 51,  /// The signal received by the monitored pin has significantly changed since the last check.
+            kTimedChanged = 52,  /// Same as kChanged, but also carries the time the signal was converted.
+            kLick = 53,  /// The lick has ended. Carries the onset, duration, peak and inter-lick interval of the lick.
+            kRewarded = 54,  /// The lick-triggered reward was delivered. Carries the lick and valve opening times.
+            kParametersRestored = 55,  /// The runtime parameters were restored from the emulated EEPROM.
+            kWatchdogUnavailable = 56,  /// The watchdog could not start because ADC2 is claimed by another user.
+            kStoreRefused = 57,  /// The parameters were not stored, as the watchdog is active.
         };
 
         /// Assigns meaningful names to module command byte-codes.
         enum class kModuleCommands : uint8_t
         {
-            kCheckState = 1,  ///< Checks the state of the input pin, and if necessary informs the PC of any changes.
+            kCheckState    = 1,  ///< Checks the state of the input pin, and if necessary informs the PC of any changes.
+            kStartWatchdog = 2,  ///< Starts detecting the licks with the ADC hardware compare function.
+            kStopWatchdog  = 3,  ///< Stops the hardware lick detection and reverts to software detection.
+            kArmReward     = 4,  ///< Arms the lick-triggered reward delivery using the current reward parameters.
+            kDisarmReward  = 5,  ///< Disarms the lick-triggered reward delivery.
+            kStoreParameters = 6,  ///< Commits the current runtime parameters to the emulated EEPROM.
         };
 
         /// Initializes the TTLModule class by subclassing the base Module class.
@@ -70,20 +126,39 @@ class LickModule final : public Module
         /// reception buffer.
         bool SetCustomParameters() override
         {
+            AXMC_PROFILE_CALL(0);
+
             // Extracts the received parameters into the _custom_parameters structure of the class. If extraction fails,
             // returns false. This instructs the Kernel to execute the necessary steps to send an error message to the
             // PC.
-            return _communication.ExtractModuleParameters(_custom_parameters);
+            if (!_communication.ExtractModuleParameters(_custom_parameters)) return false;
+
+            // Applies the new thresholds to the lick event detector. This discards any partially detected lick.
+            ConfigureDetector();
+            _schedule.Configure(_custom_parameters.service_period);
+            return true;
         }
 
         /// Executes the currently active command.
         bool RunActiveCommand() override
         {
+            AXMC_PROFILE_CALL(GetActiveCommand());
+
             // Depending on the currently active command, executes the necessary logic.
             switch (static_cast<kModuleCommands>(GetActiveCommand()))
             {
                 // CheckState
                 case kModuleCommands::kCheckState: CheckState(); return true;
+                // StartWatchdog
+                case kModuleCommands::kStartWatchdog: StartWatchdog(); return true;
+                // StopWatchdog
+                case kModuleCommands::kStopWatchdog: StopWatchdog(); return true;
+                // ArmReward
+                case kModuleCommands::kArmReward: ArmReward(); return true;
+                // DisarmReward
+                case kModuleCommands::kDisarmReward: DisarmReward(); return true;
+                // StoreParameters
+                case kModuleCommands::kStoreParameters: StoreParameters(); return true;
                 // Unrecognized command
                 default: return false;
             }
@@ -95,10 +170,37 @@ class LickModule final : public Module
             // Sets pin to Input mode.
             pinModeFast(kPin, INPUT_PULLDOWN);
 
+            // Registers the pin with the ADC front-end. Fails the setup if all front-end slots are taken.
+            _adc_slot = AdcFrontend::Register(kPin);
+            if (_adc_slot == AdcFrontend::kInvalidSlot) return false;
+
             // Resets the custom_parameters structure fields to their default values. Assumes 12-bit ADC resolution.
             _custom_parameters.signal_threshold  = 200;  // Ideally should be just high enough to filter out noise
             _custom_parameters.delta_threshold   = 180;  // Ideally should be at least half of the minimal threshold
-            _custom_parameters.average_pool_size = 0;    // Better to have at 0 because Teensy already does this
+            _custom_parameters.average_pool_size = 0;    // Averaging is done by the ADC hardware, see AdcFrontend
+            _custom_parameters.event_mode        = false;  // Reports the signal changes by default
+            _custom_parameters.debounce_duration = 5000;   // Merges contact breaks shorter than 5 ms into one lick
+            _custom_parameters.reward_duration   = 35000;  // Matches the default ValveModule pulse duration
+            _custom_parameters.reward_refractory = 500000;
+            _custom_parameters.reward_count      = 1;
+            _custom_parameters.service_period    = 0;  // Checks the sensor every runtime cycle
+
+            // Replaces the defaults with the parameters committed to the emulated EEPROM, if they are valid, and
+            // notifies the PC that it does not need to resend them.
+            if (ParameterStore::Load(_store_address, GetModuleType(), GetModuleID(), _custom_parameters))
+            {
+                SendData(static_cast<uint8_t>(kCustomStatusCodes::kParametersRestored));
+            }
+
+            // Ensures the hardware lick detection is not running and resets the detection state when the module is
+            // (re)set.
+            _watchdog.Stop();
+            _watchdog.SetRewardLink(&_reward);
+            _reward.Disarm();
+            _previous_readout = 0;
+            _previous_zero    = true;
+            ConfigureDetector();
+            _schedule.Configure(_custom_parameters.service_period);
 
             // Notifies the PC about the initial sensor state. Primarily, this is needed to support data source
             // time-alignment during post-processing.
@@ -111,6 +213,20 @@ class LickModule final : public Module
             return true;
         }
 
+        /**
+         * @brief Links the reward valve to the sensor.
+         *
+         * This method has to be called by the runtime setup code before the Kernel is set up. The link stays inactive
+         * until the PC arms it with the ArmReward command.
+         *
+         * @tparam Valve the type of the ValveModule instance to link.
+         */
+        template <class Valve>
+        void LinkValve(Valve&)
+        {
+            _reward.Attach(Valve::Deliver);
+        }
+
         ~LickModule() override = default;
 
     private:
@@ -120,23 +236,177 @@ class LickModule final : public Module
                 uint16_t signal_threshold = 200;  ///< The lower boundary for signals to be reported to PC.
                 uint16_t delta_threshold  = 180;  ///< The minimum difference between checks to be reported to PC.
                 uint8_t average_pool_size = 0;    ///< The number of readouts to average into pin state value.
+                bool event_mode = false;          ///< Determines whether to report licks instead of signal changes.
+                uint32_t debounce_duration = 5000;  ///< The time, in us, the signal has to stay low to end the lick.
+                uint32_t reward_duration   = 35000;   ///< The time, in us, to keep the valve open for each reward.
+                uint32_t reward_refractory = 500000;  ///< The minimum time, in us, between two consecutive rewards.
+                uint16_t reward_count      = 1;       ///< The number of rewards per arming. 0 means unlimited rewards.
+                uint32_t service_period    = 0;       ///< The target time, in us, between checks. 0 checks every cycle.
         } PACKED_STRUCT _custom_parameters;
 
+        /// Paces the CheckState command to the service_period.
+        ModuleSchedule _schedule;
+
+        /// The AdcFrontend slot used to convert the pin readouts.
+        uint8_t _adc_slot = AdcFrontend::kInvalidSlot;
+
+        /// The emulated EEPROM address of the module's parameter record.
+        uint16_t _store_address = ParameterStore::kInvalidAddress;
+
+        /// Stores the previous readout of the analog pin. This is used to limit the number of messages sent to the
+        /// PC by only reporting significant changes of the pin state (signal). The level that constitutes
+        /// significant change can be adjusted through the custom_parameters structure.
+        uint16_t _previous_readout = 0;
+
+        /// Tracks whether the previous message sent to the PC included a zero signal value.
+        bool _previous_zero = true;  // A zero-message is sent at class initialization.
+
+        /// Detects the licks in hardware when the watchdog is started.
+        AdcWatchdog<kPin> _watchdog;
+
+        /// Extracts the lick events from the signal when the event mode is enabled.
+        LickEventDetector _detector;
+
+        /// Delivers the lick-triggered rewards through the linked valve.
+        RewardLink _reward;
+
+        /// Arms the lick-triggered reward delivery.
+        void ArmReward()
+        {
+            // Aborts the command if no valve is linked to the sensor.
+            if (!_reward.Arm(
+                    _custom_parameters.reward_duration,
+                    _custom_parameters.reward_refractory,
+                    _custom_parameters.reward_count
+                ))
+            {
+                AbortCommand();
+                return;
+            }
+            CompleteCommand();
+        }
+
+        /// Disarms the lick-triggered reward delivery.
+        void DisarmReward()
+        {
+            _reward.Disarm();
+            CompleteCommand();
+        }
+
+        /// Configures the lick event detector to use the current thresholds.
+        void ConfigureDetector()
+        {
+            const uint16_t upper = _custom_parameters.signal_threshold;
+            const uint16_t delta = _custom_parameters.delta_threshold;
+            _detector.Configure(upper, upper > delta ? upper - delta : 0, _custom_parameters.debounce_duration);
+        }
+
+        /// Commits the current runtime parameters to the emulated EEPROM, so that they are restored when the
+        /// microcontroller resets. Aborts the command if the EEPROM does not have enough free space. Since the flash
+        /// write delays the crossing interrupt, and with it the crossing timestamps and the lick-triggered rewards (see
+        /// parameter_store.h), the command is also aborted, with the kStoreRefused message, while the watchdog is
+        /// active.
+        void StoreParameters()
+        {
+            if (_watchdog.IsActive())
+            {
+                SendData(static_cast<uint8_t>(kCustomStatusCodes::kStoreRefused));
+                AbortCommand();
+                return;
+            }
+            if (!ParameterStore::Save(_store_address, GetModuleType(), GetModuleID(), _custom_parameters))
+            {
+                AbortCommand();
+                return;
+            }
+            CompleteCommand();
+        }
+
+        /// Starts detecting the licks with the ADC hardware compare function.
+        void StartWatchdog()
+        {
+            // The lower threshold provides the same hysteresis the software detection gets from the delta threshold.
+            const uint16_t upper = _custom_parameters.signal_threshold;
+            const uint16_t delta = _custom_parameters.delta_threshold;
+            const uint16_t lower = upper > delta ? upper - delta : 0;
+
+            // Aborts the command if ADC2 is claimed by another user, such as the analog stream or the watchdog of
+            // another sensor.
+            if (!_watchdog.Start(upper, lower))
+            {
+                SendData(static_cast<uint8_t>(kCustomStatusCodes::kWatchdogUnavailable));
+                AbortCommand();
+                return;
+            }
+            CompleteCommand();
+        }
+
+        /// Stops the hardware lick detection.
+        void StopWatchdog()
+        {
+            _watchdog.Stop();
+            CompleteCommand();
+        }
+
         /// Checks the signal received by the input pin and, if necessary, reports it to the PC.
         void CheckState()
         {
-            // Stores the previous readout of the analog pin. This is used to limit the number of messages sent to the
-            // PC by only reporting significant changes of the pin state (signal). The level that constitutes
-            // significant change can be adjusted through the custom_parameters structure.
-            static uint16_t previous_readout = 0;
+            // Skips the check if the sensor is not due for service yet.
+            if (!_schedule.IsDue())
+            {
+                CompleteCommand();
+                return;
+            }
 
-            // Tracks whether the previous message sent to the PC included a zero signal value.
-            static bool previous_zero = true;  // A zero-message is sent at class initialization.
+            // If the hardware lick detection is active, the crossings are already waiting in the watchdog queue.
+            // Onsets are reported with the crossing value and offsets with a zero value, similar to software detection.
+            if (_watchdog.IsActive())
+            {
+                AdcCrossing crossing;
+                while (_watchdog.Read(crossing))
+                {
+                    if (_custom_parameters.event_mode)
+                    {
+                        if (_detector.AddCrossing(crossing.rising, crossing.value, crossing.timestamp)) SendEvent();
+                        continue;
+                    }
+                    SendSignal(crossing.rising ? crossing.value : 0, crossing.timestamp, true);
+                    _previous_zero = !crossing.rising;
+                }
+                if (_custom_parameters.event_mode && _detector.Poll(micros())) SendEvent();
 
-            // Evaluates the state of the pin. Averages the requested number of readouts to produce the final
-            // analog signal value. Note, since we statically configure the controller to use 10-14 bit ADC resolution,
-            // this value should not use the full range of the 16-bit uint variable.
-            const uint16_t signal = AnalogRead(kPin, _custom_parameters.average_pool_size); 
+                // The rewards are delivered by the crossing interrupt, so they are only reported here.
+                ReportReward();
+                CompleteCommand();
+                return;
+            }
+
+            // Collects the readout converted since the previous check and immediately requests the next one, so that
+            // the conversion runs while the Kernel services other modules. The ADC hardware averages the requested
+            // number of readouts to produce the final analog signal value. If the conversion has not completed yet,
+            // there is nothing to evaluate during this check. Note, since we statically configure the controller to use
+            // 10-14 bit ADC resolution, this value should not use the full range of the 16-bit uint variable.
+            uint16_t signal;
+            uint32_t timestamp;
+            const bool converted = AdcFrontend::Read(_adc_slot, signal, timestamp);
+            AdcFrontend::Request(_adc_slot, _custom_parameters.average_pool_size);
+
+            // In the event mode, only the completed licks are reported. If there is no new readout, the detector still
+            // has to check whether the debounce period of the ongoing lick has elapsed.
+            if (_custom_parameters.event_mode)
+            {
+                const bool completed = converted ? _detector.Add(signal, timestamp) : _detector.Poll(micros());
+                if (_detector.TakeOnset() && _reward.Fire(timestamp)) ReportReward();
+                if (completed) SendEvent();
+                CompleteCommand();
+                return;
+            }
+
+            if (!converted)
+            {
+                CompleteCommand();
+                return;
+            }
 
             // Calculates the absolute difference between the current signal and the previous readout. This is used
             // to ensure only significant signal changes are reported to the PC. Note, although we are casting both to
@@ -144,7 +414,7 @@ class LickModule final : public Module
             // Therefore, it is fine to cast it back to uint16 to avoid unnecessary future casting in the 'if'
             // statements.
             const auto delta =
-                static_cast<uint16_t>(abs(static_cast<int32_t>(signal) - static_cast<int32_t>(previous_readout)));
+                static_cast<uint16_t>(abs(static_cast<int32_t>(signal) - static_cast<int32_t>(_previous_readout)));
 
             // Prevents reporting signals that are not significantly different from the previous readout value.
             if (delta <= _custom_parameters.delta_threshold)
@@ -153,37 +423,87 @@ class LickModule final : public Module
                 return;
             }
 
-            previous_readout = signal;  // Overwrites the previous readout with the current signal
+            _previous_readout = signal;  // Overwrites the previous readout with the current signal
 
             // If the signal is above the threshold, sends it to the PC
             if (signal >= _custom_parameters.signal_threshold)
             {
+                // Delivers the reward before anything is sent to the PC to minimize the lick-to-reward latency.
+                if (_previous_zero && _reward.Fire(timestamp)) ReportReward();
+
                 // Sends the detected signal to the PC.
-                SendData(
-                    static_cast<uint8_t>(kCustomStatusCodes::kChanged),
-                    kPrototypes::kOneUint16,
-                    signal
-                );
-                previous_zero = false;
+                SendSignal(signal, timestamp, AdcFrontend::IsPaired(_adc_slot));
+                _previous_zero = false;
             }
 
             // If the signal is below the threshold, pulls it to 0 and notifies the PC
             else
             {
-                if (!previous_zero)
+                if (!_previous_zero)
                 {
-                    SendData(
-                        static_cast<uint8_t>(kCustomStatusCodes::kChanged),
-                        kPrototypes::kOneUint16,
-                        0
-                    );
-                    previous_zero = true;
+                    SendSignal(0, timestamp, AdcFrontend::IsPaired(_adc_slot));
+                    _previous_zero = true;
                 }
             }
 
             // Completes command execution
             CompleteCommand();
         }
+
+        /**
+         * @brief Sends the signal to the PC.
+         *
+         * @param signal the signal to send.
+         * @param timestamp the micros() time at which the signal was converted.
+         * @param timed determines whether to include the timestamp. This is used when the timestamp is more accurate
+         * than the message reception time, for example, to align the readouts of paired pins or to report the exact
+         * time of the hardware-detected crossings.
+         */
+        void SendSignal(const uint16_t signal, const uint32_t timestamp, const bool timed)
+        {
+            if (!timed)
+            {
+                SendData(
+                    static_cast<uint8_t>(kCustomStatusCodes::kChanged),
+                    kPrototypes::kOneUint16,
+                    signal
+                );
+                return;
+            }
+
+            const uint32_t data[2] = {timestamp, signal};
+            SendData(
+                static_cast<uint8_t>(kCustomStatusCodes::kTimedChanged),
+                kPrototypes::kTwoUint32s,
+                data
+            );
+        }
+
+        /// Sends the most recently delivered lick-triggered reward to the PC, if it has not been sent yet.
+        void ReportReward()
+        {
+            RewardRecord record;
+            if (!_reward.Read(record)) return;
+
+            const uint32_t data[3] = {record.lick, record.delivered, record.remaining};
+            SendData(
+                static_cast<uint8_t>(kCustomStatusCodes::kRewarded),
+                kPrototypes::kThreeUint32s,
+                data
+            );
+        }
+
+        /// Sends the most recently completed lick to the PC.
+        void SendEvent()
+        {
+            const LickEvent& event = _detector.GetEvent();
+            const uint32_t data[4] = {event.onset, event.duration, event.peak, event.interval};
+            SendData(
+                static_cast<uint8_t>(kCustomStatusCodes::kLick),
+                kPrototypes::kFourUint32s,
+                data
+            );
+        }
 };
 
 #endif  //AXMC_LICK_MODULE_H
@@ -0,0 +1,132 @@
+/**
+ * @file
+ * @brief The header-only file for the LickScan class. This class allows packing the significant state changes of
+ * multiple lick sensors into a single message, which is the wire format used by the LickArrayModule class.
+ *
+ * Each scan collects one readout per sensor. A readout is significant if it differs from the previous significant
+ * readout of the same sensor by more than the delta threshold. Significant readouts at or above the signal threshold
+ * are reported as-is, and significant readouts below it are pulled to 0 and reported only once, following the
+ * LickModule conventions.
+ *
+ * The scan message is a uint16 array of kCount + 1 elements: [changed sensor bitmask, sensor 0 value, ..., sensor
+ * kCount - 1 value]. Bit i of the bitmask corresponds to the value at index i + 1. The values of the unchanged sensors
+ * are 0 and should be ignored.
+ *
+ * @note This file only depends on the standard library, so that it can be compiled and tested on the host-PC.
+ */
+
+#ifndef AXMC_LICK_SCAN_H
+#define AXMC_LICK_SCAN_H
+
+#include <cstdint>
+
+/**
+ * @brief Tracks the detection state of kCount lick sensors and packs their changes into scan messages.
+ *
+ * Use Begin() at the start of each scan, Add() for every converted readout and GetMessage() to retrieve the packed
+ * message once HasChanges() returns true.
+ *
+ * @tparam kCount the number of sensors. Supports up to 8 sensors.
+ */
+template <const uint8_t kCount>
+class LickScan
+{
+        // Ensures that the changed sensor bitmask fits into its message element.
+        static_assert(kCount >= 1 && kCount <= 8, "LickScan supports between 1 and 8 sensors.");
+
+    public:
+        /// The number of elements in the scan message.
+        static constexpr uint8_t kMessageSize = kCount + 1;
+
+        /// The bitmask with a bit set for every sensor.
+        static constexpr uint8_t kAllSensors = static_cast<uint8_t>((1U << kCount) - 1);
+
+        /// Discards the detection state of all sensors. The sensors start at 0, which is assumed to be already
+        /// reported (see GetInitialMessage()).
+        void Reset()
+        {
+            for (auto& readout : _previous_readouts) readout = 0;
+            _previous_zeros = kAllSensors;
+            Begin();
+        }
+
+        /// Clears the message before the next scan.
+        void Begin()
+        {
+            for (auto& value : _message) value = 0;
+        }
+
+        /**
+         * @brief Adds the sensor readout to the scan.
+         *
+         * @param sensor the index of the sensor, from 0 to kCount - 1.
+         * @param signal the sensor readout.
+         * @param signal_threshold the lowest signal value reported as-is.
+         * @param delta_threshold the difference from the previous significant readout a readout has to exceed to be
+         * significant.
+         */
+        void Add(
+            const uint8_t sensor,
+            const uint16_t signal,
+            const uint16_t signal_threshold,
+            const uint16_t delta_threshold
+        )
+        {
+            if (sensor >= kCount) return;
+
+            // Ignores readouts that are not significantly different from the previous readout.
+            const int32_t difference = static_cast<int32_t>(signal) - static_cast<int32_t>(_previous_readouts[sensor]);
+            const auto delta         = static_cast<uint16_t>(difference < 0 ? -difference : difference);
+            if (delta <= delta_threshold) return;
+            _previous_readouts[sensor] = signal;
+
+            const auto bit = static_cast<uint8_t>(1U << sensor);
+            if (signal >= signal_threshold)
+            {
+                // Reports the above-threshold signal.
+                _message[0] |= bit;
+                _message[sensor + 1] = signal;
+                _previous_zeros &= ~bit;
+            }
+            else if (!(_previous_zeros & bit))
+            {
+                // Pulls the below-threshold signal to 0, but only reports it once.
+                _message[0] |= bit;
+                _message[sensor + 1] = 0;
+                _previous_zeros |= bit;
+            }
+        }
+
+        /// Returns true if any sensor changed during the current scan.
+        [[nodiscard]] bool HasChanges() const
+        {
+            return _message[0] != 0;
+        }
+
+        /// Returns the message of the current scan.
+        [[nodiscard]] const uint16_t (&GetMessage() const)[kMessageSize]
+        {
+            return _message;
+        }
+
+        /// Returns the message that reports all sensors at 0, which is sent when the sensors are set up.
+        static constexpr const uint16_t (&GetInitialMessage())[kMessageSize]
+        {
+            return kInitialMessage;
+        }
+
+    private:
+        /// The message that reports all sensors at 0.
+        static constexpr uint16_t kInitialMessage[kMessageSize] = {kAllSensors};
+
+        /// The message of the current scan.
+        uint16_t _message[kMessageSize] = {};
+
+        /// The previous significant readout of each sensor.
+        uint16_t _previous_readouts[kCount] = {};
+
+        /// The bitmask of sensors whose previous message sent to the PC included a zero signal value.
+        uint8_t _previous_zeros = kAllSensors;
+};
+
+#endif  //AXMC_LICK_SCAN_H
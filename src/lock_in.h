@@ -0,0 +1,207 @@
+/**
+ * @file
+ * @brief The header-only file for the LockInDemodulator class. This class allows recovering the amplitude and phase of
+ * a signal modulated at a known excitation frequency directly on the microcontroller.
+ *
+ * The demodulator multiplies each sample by the in-phase (cosine) and quadrature (sine) outputs of a numerically
+ * controlled oscillator (NCO) running at the excitation frequency and accumulates the products over a fixed window of
+ * samples. The NCO phase is derived from each sample's micros() timestamp, so the demodulator works both for samples
+ * acquired at a fixed rate and for samples acquired whenever the module's command runs. The DC component of the
+ * signal is removed from the accumulated products, so the window does not need to span a whole number of excitation
+ * periods. Components at other frequencies cancel out if the window spans a whole number of their beat periods with
+ * the excitation, and otherwise leak into the result by at most their amplitude / (pi * frequency difference * window
+ * duration).
+ *
+ * @note This file only depends on the standard library, so that it can be compiled and tested on the host-PC.
+ */
+
+#ifndef AXMC_LOCK_IN_H
+#define AXMC_LOCK_IN_H
+
+#include <cmath>
+#include <cstdint>
+
+/**
+ * @brief Demodulates the samples at the configured excitation frequency and produces one amplitude and phase pair
+ * per integration window.
+ *
+ * The NCO uses a 32-bit phase accumulator and a 1024-entry Q15 sine table. All per-sample math is integer; the
+ * amplitude and phase are resolved with floating-point math once per window.
+ */
+class LockInDemodulator
+{
+    public:
+        /**
+         * @brief Configures the demodulator and discards any partially accumulated window.
+         *
+         * @param frequency the excitation frequency, in Hz.
+         * @param window the number of samples integrated into each amplitude and phase pair. Setting this to 0
+         * disables the demodulator.
+         */
+        void Configure(const uint16_t frequency, const uint16_t window)
+        {
+            // Converts the frequency into the phase advance per microsecond, where 2^32 is a full turn.
+            _phase_per_micro = static_cast<uint32_t>(
+                (static_cast<uint64_t>(frequency) << 32) / 1000000UL
+            );
+            _window = window;
+            Clear();
+        }
+
+        /// Returns true if the demodulator is configured to integrate samples.
+        [[nodiscard]] bool IsEnabled() const
+        {
+            return _window != 0;
+        }
+
+        /**
+         * @brief Adds the sample to the integration window.
+         *
+         * @param sample the sample to add.
+         * @param timestamp the micros() time at which the sample was acquired.
+         * @returns true if the sample completed the window. In this case, the window results are available through
+         * the getter methods until the next call to Add().
+         */
+        bool Add(const uint16_t sample, const uint32_t timestamp)
+        {
+            if (_count == 0)
+            {
+                Clear();
+                _start = timestamp;
+            }
+
+            // Derives the NCO phase from the timestamp. Since 2^32 microseconds are not a whole number of excitation
+            // periods, the NCO phase jumps relative to the excitation when micros() overflows (every ~71 minutes),
+            // which distorts the window that spans the overflow.
+            const uint32_t phase = timestamp * _phase_per_micro;
+            const int32_t sine   = kSine.values[phase >> kPhaseShift];
+            const int32_t cosine = kSine.values[(phase + kQuarterTurn) >> kPhaseShift];
+
+            _sum_i += static_cast<int64_t>(sample) * cosine;
+            _sum_q += static_cast<int64_t>(sample) * sine;
+            _sum_cosine += cosine;
+            _sum_sine += sine;
+            _sum_sample += sample;
+
+            if (++_count < _window) return false;
+
+            Resolve();
+            _count = 0;
+            return true;
+        }
+
+        /// Returns the amplitude of the excitation-frequency component in the last window, in ADC units, as an
+        /// unsigned Q16.16 fixed-point number.
+        [[nodiscard]] uint32_t GetAmplitude() const
+        {
+            return _amplitude;
+        }
+
+        /// Returns the phase of the excitation-frequency component in the last window relative to the NCO cosine, as
+        /// a fraction of the full turn, where 2^32 is a full turn.
+        [[nodiscard]] uint32_t GetPhase() const
+        {
+            return _phase;
+        }
+
+        /// Returns the micros() timestamp of the first sample in the last window.
+        [[nodiscard]] uint32_t GetStart() const
+        {
+            return _start;
+        }
+
+    private:
+        /// The number of bits used to index the sine table.
+        static constexpr uint8_t kTableBits = 10;
+
+        /// The shift that converts the 32-bit phase accumulator into the sine table index.
+        static constexpr uint8_t kPhaseShift = 32 - kTableBits;
+
+        /// The phase accumulator value that corresponds to a quarter of the full turn.
+        static constexpr uint32_t kQuarterTurn = 1UL << 30;
+
+        /// The value of 2 * pi used to convert between radians and turns.
+        static constexpr double kTwoPi = 6.283185307179586;
+
+        /// Stores the Q15 sine table. The table is filled once at startup, before setup() runs.
+        struct SineTable
+        {
+                int16_t values[1U << kTableBits] = {};
+
+                SineTable()
+                {
+                    for (uint16_t i = 0; i < (1U << kTableBits); ++i)
+                    {
+                        values[i] = static_cast<int16_t>(lround(32767.0 * sin(kTwoPi * i / (1U << kTableBits))));
+                    }
+                }
+        };
+
+        /// The sine table shared by all instances.
+        static inline const SineTable kSine {};
+
+        /// Resets the window accumulators.
+        void Clear()
+        {
+            _count      = 0;
+            _sum_i      = 0;
+            _sum_q      = 0;
+            _sum_cosine = 0;
+            _sum_sine   = 0;
+            _sum_sample = 0;
+        }
+
+        /// Resolves the amplitude and phase of the completed window.
+        void Resolve()
+        {
+            // Removes the product of the signal mean and the oscillator, which is non-zero whenever the window does not
+            // span a whole number of excitation periods.
+            const double mean = static_cast<double>(_sum_sample) / _count;
+            const double i    = static_cast<double>(_sum_i) - mean * static_cast<double>(_sum_cosine);
+            const double q    = static_cast<double>(_sum_q) - mean * static_cast<double>(_sum_sine);
+
+            // Each product accumulates half of the component amplitude scaled by the Q15 oscillator amplitude.
+            const double amplitude = 2.0 * sqrt(i * i + q * q) / (static_cast<double>(_count) * 32767.0);
+            _amplitude = static_cast<uint32_t>(amplitude * 65536.0);
+
+            // For a signal proportional to cos(NCO + phase), the quadrature product is proportional to -sin(phase).
+            // Converts the phase from radians to the fraction of the full turn. The cast through the signed type keeps
+            // negative phases wrapped into the upper half of the range.
+            _phase = static_cast<uint32_t>(static_cast<int64_t>(atan2(-q, i) / kTwoPi * 4294967296.0));
+        }
+
+        /// The NCO phase advance per microsecond, where 2^32 is a full turn.
+        uint32_t _phase_per_micro = 0;
+
+        /// The number of samples integrated into each window.
+        uint16_t _window = 0;
+
+        /// The number of samples integrated into the current window.
+        uint16_t _count = 0;
+
+        /// The micros() timestamp of the first sample in the current window.
+        uint32_t _start = 0;
+
+        /// The in-phase accumulator.
+        int64_t _sum_i = 0;
+
+        /// The quadrature accumulator.
+        int64_t _sum_q = 0;
+
+        /// The sum of the in-phase oscillator outputs.
+        int64_t _sum_cosine = 0;
+
+        /// The sum of the quadrature oscillator outputs.
+        int64_t _sum_sine = 0;
+
+        /// The sum of the samples.
+        uint32_t _sum_sample = 0;
+
+        /// The amplitude resolved for the last window, in ADC units (Q16.16).
+        uint32_t _amplitude = 0;
+
+        /// The phase resolved for the last window, as a fraction of the full turn.
+        uint32_t _phase = 0;
+};
+
+#endif  //AXMC_LOCK_IN_H
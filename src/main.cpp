@@ -15,8 +15,12 @@
 #include <kernel.h>
 #include <module.h>
 
-// Initializes the serial communication class.
-Communication axmc_communication(Serial);  // NOLINT(*-interfaces-global-init)
+#include "counting_stream.h"
+
+// Initializes the serial communication class. The serial port is wrapped to count the outgoing traffic for the
+// TelemetryModule.
+CountingStream axmc_stream(Serial);              // NOLINT(*-interfaces-global-init)
+Communication axmc_communication(axmc_stream);  // NOLINT(*-interfaces-global-init)
 
 // Defines the target microcontroller. Our VR system currently has 3 valid targets: ACTOR, SENSOR and ENCODER. 
 // WJ note: only ACTOR is currently used.
@@ -25,12 +29,30 @@ Communication axmc_communication(Serial);  // NOLINT(*-interfaces-global-init)
 // Use the same controller as for valve and lick
 
 #include "valve_module.h"
+#include "valve_group.h"
 #include "lick_module.h"
 #include "analog_module.h"
+#include "telemetry_module.h"
+
+// The profiling builds (see the teensy40_profile environment in platformio.ini) time every module command and expose
+// the collected statistics through the ProfilerModule.
+#ifdef AXMC_PROFILING
+#include "profiler_module.h"
+#endif
 
 constexpr uint8_t kControllerID = 111;
 constexpr uint32_t kKeepAliveInterval = 1000;  // 1 second == 1000 ms
 
+// Determines whether the photometry pin and the left lick sensor pin are converted simultaneously by ADC1 and ADC2.
+// This gives both readouts the same timestamp, so the lick and photometry data stay phase-aligned. While the analog
+// stream or the lick watchdog uses ADC2, the paired pins are converted one after another by ADC1 instead.
+constexpr bool kPairSensors = true;
+
+// The Teensy 4.0 has 4 PIT channels. Each valve holds one while its pulse is in progress, and the analog stream holds
+// one while it runs, so this layout uses at most 3 channels. The bilateral valve group (see setup()) holds one channel
+// instead of the valve channels, as the group pulse is only started while both valves are idle. Adding more valves or
+// timers beyond this budget makes the valve pulse commands fail with the kTimerUnavailable message whenever all
+// channels are busy.
 ValveModule<16, true> left_valve(1, 1, axmc_communication);
 ValveModule<9,  true> right_valve(1, 2, axmc_communication);
 
@@ -39,12 +61,22 @@ LickModule<23>  right_lick_sensor(2, 2, axmc_communication);
 
 AnalogModule<14> analog_signal(3, 1, axmc_communication);
 
+TelemetryModule telemetry(5, 1, axmc_communication, axmc_stream);
+
+#ifdef AXMC_PROFILING
+ProfilerModule profiler(4, 1, axmc_communication);
+#endif
+
 Module* modules[] = {
     &left_valve,
     &right_valve,
     &left_lick_sensor,
     &right_lick_sensor,
-    &analog_signal
+    &analog_signal,
+    &telemetry,
+#ifdef AXMC_PROFILING
+    &profiler,
+#endif
 };
 
 // Instantiates the Kernel class using the assets instantiated above.
@@ -57,10 +89,24 @@ void setup()
     // Sets ADC resolution to 12 bits. Teensy boards can support up to 16 bits, but 12 often produces cleaner readouts.
     analogReadResolution(12);
 
+    // Pairs the photometry and lick sensor pins before the modules start requesting conversions.
+    if (kPairSensors) AdcFrontend::Pair(14, 22);
+
+    // Links each lick sensor to the valve on the same side. The PC arms the lick-triggered rewards at runtime.
+    left_lick_sensor.LinkValve(left_valve);
+    right_lick_sensor.LinkValve(right_valve);
+
+    // Groups the valves, so that the left valve's SendGroupPulse command delivers bilateral rewards. The two valves
+    // are on different GPIO ports (GPIO6 and GPIO7), so they switch within a few CPU cycles of each other.
+    left_valve.LinkGroup(right_valve);
+
     axmc_kernel.Setup();  // Carries out the rest of the setup depending on the module configuration.
 }
 
 void loop()
 {
+    telemetry.Tick();  // Measures the loop timing for the TelemetryModule.
     axmc_kernel.RuntimeCycle();
+    left_valve.Service();
+    right_valve.Service();
 }
@@ -0,0 +1,115 @@
+/**
+ * @file
+ * @brief The header-only file for the ModuleSchedule class. This class allows modules to service their polling
+ * commands at a target rate instead of every runtime cycle, so that the runtime cycle time is spent on the modules
+ * whose data rate requires it.
+ *
+ * The Kernel class provided by the ataraxis-micro-controller library visits every module with an active command in
+ * each runtime cycle, in the order of the module array. The schedule does not change this order. Instead, each
+ * scheduled module checks its deadline at the start of the polling command and returns immediately if it is not due,
+ * which costs a single micros() comparison. The deadlines advance by exactly one period per dispatch, so the service
+ * rate does not drift with the runtime cycle jitter, unlike the recurrent command delay, which is counted from the
+ * previous dispatch.
+ *
+ * A dispatch that happens a full period or more after its deadline means that at least one service slot was missed.
+ * Such dispatches are counted as overruns, and the schedule restarts from the time of the late dispatch instead of
+ * trying to catch up with the missed slots. The checks that return early because the module is not due yet are counted
+ * as skips, which is the number of polling commands the schedule saved. The dispatch, skip and overrun counters are
+ * shared by all modules and are reported by the TelemetryModule (see telemetry_module.h).
+ *
+ * @note The counters only cover the modules that gate their polling command with a non-zero service period. The
+ * modules that are serviced every runtime cycle (period 0) and the modules that do not use the schedule are not
+ * counted, so the counters do not describe the total number of commands the Kernel runs.
+ *
+ * @section mod_sch_dependencies Dependencies:
+ * - Arduino.h for Arduino platform functions and macros and cross-compatibility with Arduino IDE (to an extent).
+ */
+
+#ifndef AXMC_MODULE_SCHEDULE_H
+#define AXMC_MODULE_SCHEDULE_H
+
+#include <cstdint>
+#include <Arduino.h>
+
+/// Tracks the service deadline of a single module.
+class ModuleSchedule
+{
+    public:
+        /**
+         * @brief Sets the service period and makes the module due immediately.
+         *
+         * @param period the target time, in microseconds, between two consecutive services. 0 services the module
+         * every runtime cycle.
+         */
+        void Configure(const uint32_t period)
+        {
+            _period   = period;
+            _deadline = micros();
+        }
+
+        /// Returns true if the module is due for service. Each call that returns true counts as a dispatch and
+        /// advances the deadline by one period. Each call that returns false counts as a skip. The calls of the
+        /// modules that are serviced every runtime cycle are not counted.
+        bool IsDue()
+        {
+            if (_period == 0) return true;
+
+            const uint32_t now = micros();
+            if (static_cast<int32_t>(now - _deadline) < 0)
+            {
+                ++_skips;
+                return false;
+            }
+
+            ++_dispatches;
+            if (now - _deadline >= _period)
+            {
+                ++_overruns;
+                _deadline = now + _period;
+            }
+            else _deadline += _period;
+            return true;
+        }
+
+        /// Returns the number of scheduled dispatches of all modules since the previous call and resets the counter.
+        static uint32_t TakeDispatches()
+        {
+            const uint32_t dispatches = _dispatches;
+            _dispatches               = 0;
+            return dispatches;
+        }
+
+        /// Returns the number of skipped checks of all modules since the previous call and resets the counter.
+        static uint32_t TakeSkips()
+        {
+            const uint32_t skips = _skips;
+            _skips               = 0;
+            return skips;
+        }
+
+        /// Returns the number of overruns of all modules since the previous call and resets the counter.
+        static uint32_t TakeOverruns()
+        {
+            const uint32_t overruns = _overruns;
+            _overruns               = 0;
+            return overruns;
+        }
+
+    private:
+        /// The target time, in microseconds, between two consecutive services.
+        uint32_t _period = 0;
+
+        /// The micros() time at which the module is due for the next service.
+        uint32_t _deadline = 0;
+
+        /// The number of scheduled dispatches of all modules.
+        static inline uint32_t _dispatches = 0;
+
+        /// The number of checks of all modules that returned early because the module was not due yet.
+        static inline uint32_t _skips = 0;
+
+        /// The number of scheduled dispatches of all modules that missed at least one service slot.
+        static inline uint32_t _overruns = 0;
+};
+
+#endif  //AXMC_MODULE_SCHEDULE_H
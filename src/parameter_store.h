@@ -0,0 +1,165 @@
+/**
+ * @file
+ * @brief The header-only file for the ParameterStore class. This class allows modules to persist their runtime
+ * parameters in the emulated EEPROM, so that they are restored when the microcontroller resets.
+ *
+ * Each module reserves a record the first time it is set up. Since the Kernel sets up the modules in the same order
+ * during every boot, each module receives the same record address across resets. Each record starts with a header that
+ * stores the layout version, the owning module's type and ID, the parameter structure size and the CRC-32 checksum of
+ * the stored parameters. The stored parameters are only loaded if all header fields match, so records written by a
+ * different firmware layout, records of a different module and partially written records are ignored.
+ *
+ * @attention Increment kLayoutVersion whenever a change of the module parameter structures keeps their size, as the
+ * size check would not detect such changes otherwise.
+ *
+ * @warning The Teensy 4.0 emulates the EEPROM in the program flash. Each changed byte is written to flash with the
+ * interrupts disabled, and once a flash sector fills up, it is erased, which can stall the CPU for milliseconds. All
+ * interrupts, including the valve closing timer, the analog stream sampling timer and the watchdog crossing interrupt,
+ * are delayed until the write completes. Therefore, the modules refuse to store their parameters while such
+ * timing-critical work is in progress.
+ *
+ * @section prm_str_dependencies Dependencies:
+ * - Arduino.h for Arduino platform functions and macros and cross-compatibility with Arduino IDE (to an extent).
+ * - EEPROM.h for the emulated EEPROM access.
+ */
+
+#ifndef AXMC_PARAMETER_STORE_H
+#define AXMC_PARAMETER_STORE_H
+
+#include <cstdint>
+#include <Arduino.h>
+#include <EEPROM.h>
+
+/**
+ * @brief Stores and loads the module runtime parameters in the emulated EEPROM.
+ *
+ * All methods are static, as the EEPROM is shared by all modules.
+ */
+class ParameterStore
+{
+    public:
+        /// The version of the stored parameter layout. Records stored with a different version are ignored.
+        static constexpr uint8_t kLayoutVersion = 1;
+
+        /// The address value used to mark the module that has not reserved its record yet.
+        static constexpr uint16_t kInvalidAddress = 0xFFFF;
+
+        /**
+         * @brief Loads the stored parameters of the module.
+         *
+         * @param address the record address of the module. If the module has not reserved its record yet, the record
+         * is reserved and its address is written to this variable.
+         * @param module_type the type of the module that owns the parameters.
+         * @param module_id the ID of the module that owns the parameters.
+         * @param parameters the parameter structure to load the stored parameters into. The structure is not modified
+         * if the method returns false.
+         * @returns true if valid stored parameters were loaded and false otherwise.
+         */
+        template <typename T>
+        static bool Load(uint16_t& address, const uint8_t module_type, const uint8_t module_id, T& parameters)
+        {
+            if (!Reserve(address, sizeof(T))) return false;
+
+            Header header;
+            EEPROM.get(address, header);
+            if (header.magic != kMagic || header.version != kLayoutVersion || header.module_type != module_type ||
+                header.module_id != module_id || header.size != sizeof(T))
+            {
+                return false;
+            }
+
+            // Verifies the checksum before touching the parameters, so that a corrupted record never replaces the
+            // defaults.
+            const uint16_t data = address + sizeof(Header);
+            uint32_t crc        = kCrcSeed;
+            for (uint16_t i = 0; i < sizeof(T); ++i) crc = UpdateCrc(crc, EEPROM.read(data + i));
+            if (~crc != header.crc) return false;
+
+            auto* bytes = reinterpret_cast<uint8_t*>(&parameters);
+            for (uint16_t i = 0; i < sizeof(T); ++i) bytes[i] = EEPROM.read(data + i);
+            return true;
+        }
+
+        /**
+         * @brief Stores the parameters of the module.
+         *
+         * Only the bytes that differ from the stored record are written to limit the EEPROM wear. The header is
+         * written last, so an interrupted write leaves a record that fails the checksum verification.
+         *
+         * @param address the record address of the module. If the module has not reserved its record yet, the record
+         * is reserved and its address is written to this variable.
+         * @param module_type the type of the module that owns the parameters.
+         * @param module_id the ID of the module that owns the parameters.
+         * @param parameters the parameter structure to store.
+         * @returns true if the parameters were stored and false if the EEPROM does not have enough free space.
+         */
+        template <typename T>
+        static bool Save(uint16_t& address, const uint8_t module_type, const uint8_t module_id, const T& parameters)
+        {
+            if (!Reserve(address, sizeof(T))) return false;
+
+            const auto* bytes   = reinterpret_cast<const uint8_t*>(&parameters);
+            const uint16_t data = address + sizeof(Header);
+            uint32_t crc        = kCrcSeed;
+            for (uint16_t i = 0; i < sizeof(T); ++i)
+            {
+                EEPROM.update(data + i, bytes[i]);
+                crc = UpdateCrc(crc, bytes[i]);
+            }
+
+            Header header;
+            header.magic       = kMagic;
+            header.version     = kLayoutVersion;
+            header.module_type = module_type;
+            header.module_id   = module_id;
+            header.size        = sizeof(T);
+            header.crc         = ~crc;
+            const auto* header_bytes = reinterpret_cast<const uint8_t*>(&header);
+            for (uint16_t i = 0; i < sizeof(Header); ++i) EEPROM.update(address + i, header_bytes[i]);
+            return true;
+        }
+
+    private:
+        /// Stores the header of each parameter record.
+        struct Header
+        {
+                uint16_t magic      = 0;  ///< Marks the record as written by this class.
+                uint8_t version     = 0;  ///< The parameter layout version.
+                uint8_t module_type = 0;  ///< The type of the module that owns the record.
+                uint8_t module_id   = 0;  ///< The ID of the module that owns the record.
+                uint16_t size       = 0;  ///< The size of the stored parameter structure.
+                uint32_t crc        = 0;  ///< The CRC-32 checksum of the stored parameter structure.
+        } PACKED_STRUCT;
+
+        /// The value stored in the magic field of every record header.
+        static constexpr uint16_t kMagic = 0xA7C5;
+
+        /// The initial value of the CRC-32 checksum.
+        static constexpr uint32_t kCrcSeed = 0xFFFFFFFF;
+
+        /// Reserves the record for the module if it has not reserved one yet. Returns false if the EEPROM does not have
+        /// enough free space for the record.
+        static bool Reserve(uint16_t& address, const uint16_t size)
+        {
+            if (address != kInvalidAddress) return true;
+
+            const uint32_t end = static_cast<uint32_t>(_next_address) + sizeof(Header) + size;
+            if (end > EEPROM.length()) return false;
+            address       = _next_address;
+            _next_address = static_cast<uint16_t>(end);
+            return true;
+        }
+
+        /// Adds the byte to the CRC-32 (IEEE 802.3, reflected) checksum.
+        static uint32_t UpdateCrc(uint32_t crc, const uint8_t byte)
+        {
+            crc ^= byte;
+            for (uint8_t bit = 0; bit < 8; ++bit) crc = (crc >> 1) ^ (0xEDB88320 & (0U - (crc & 1U)));
+            return crc;
+        }
+
+        /// The address of the next unreserved record.
+        static inline uint16_t _next_address = 0;
+};
+
+#endif  //AXMC_PARAMETER_STORE_H
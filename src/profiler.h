@@ -0,0 +1,192 @@
+/**
+ * @file
+ * @brief The header-only file for the Profiler class. This class allows measuring how many CPU cycles each module
+ * spends executing its commands and applying its runtime parameters, so that the modules that consume most of the
+ * runtime cycle can be identified.
+ *
+ * The profiler is opt-in. It is only compiled when the AXMC_PROFILING macro is defined (see the teensy40_profile
+ * environment in platformio.ini). Otherwise, the AXMC_PROFILE_CALL macro used by the modules expands to nothing, and
+ * the production firmware is not affected.
+ *
+ * Each RunActiveCommand() and SetCustomParameters() call is timed with the DWT cycle counter and recorded into the
+ * profile entry of the calling module and command. The SetCustomParameters() calls are recorded under command 0, which
+ * is not used by any module command. Each entry tracks the call count, the minimum, the sum and the maximum cycle
+ * counts and a log2 histogram of the cycle counts. The histogram is used to estimate the 99th percentile, which is
+ * reported as the upper bound of the histogram bin that contains it, so it overestimates the true percentile by at
+ * most a factor of 2.
+ *
+ * @attention The profiler uses a fixed number of entries. The calls that do not fit into the table are counted, but
+ * not recorded.
+ *
+ * @section prf_dependencies Dependencies:
+ * - Arduino.h for Arduino platform functions and macros and cross-compatibility with Arduino IDE (to an extent).
+ */
+
+#ifndef AXMC_PROFILER_H
+#define AXMC_PROFILER_H
+
+#include <cstdint>
+#include <Arduino.h>
+
+#ifdef AXMC_PROFILING
+
+/// Stores the cycle count statistics of a single module command.
+struct ProfileEntry
+{
+        uint8_t module_type = 0;     ///< The type of the profiled module.
+        uint8_t module_id   = 0;     ///< The ID of the profiled module.
+        uint8_t command     = 0;     ///< The profiled command. 0 for SetCustomParameters() calls.
+        uint32_t count      = 0;     ///< The number of recorded calls.
+        uint32_t minimum    = 0;     ///< The smallest recorded cycle count.
+        uint32_t maximum    = 0;     ///< The largest recorded cycle count.
+        uint64_t sum        = 0;     ///< The sum of all recorded cycle counts.
+        uint32_t histogram[33]{};    ///< The number of calls in each log2 cycle count bin. Bin 0 stores 0-cycle calls.
+};
+
+/**
+ * @brief Records the cycle counts of the profiled module calls.
+ *
+ * All methods are static, as the profile is shared by all modules.
+ */
+class Profiler
+{
+    public:
+        /// The maximum number of module and command pairs that can be profiled.
+        static constexpr uint8_t kCapacity = 32;
+
+        /**
+         * @brief Records the cycle count of the module call.
+         *
+         * @param module_type the type of the profiled module.
+         * @param module_id the ID of the profiled module.
+         * @param command the profiled command.
+         * @param cycles the number of CPU cycles the call took.
+         */
+        static void Record(
+            const uint8_t module_type, const uint8_t module_id, const uint8_t command, const uint32_t cycles
+        )
+        {
+            ProfileEntry* entry = Find(module_type, module_id, command);
+            if (entry == nullptr)
+            {
+                ++_dropped;
+                return;
+            }
+
+            if (entry->count == 0 || cycles < entry->minimum) entry->minimum = cycles;
+            if (cycles > entry->maximum) entry->maximum = cycles;
+            entry->sum += cycles;
+            ++entry->count;
+            ++entry->histogram[cycles == 0 ? 0 : 32 - __builtin_clz(cycles)];
+        }
+
+        /// Returns the number of profile entries.
+        static uint8_t GetSize()
+        {
+            return _size;
+        }
+
+        /// Returns the number of calls that were not recorded because the profile table was full.
+        static uint32_t GetDropped()
+        {
+            return _dropped;
+        }
+
+        /// Returns the profile entry with the given index.
+        static const ProfileEntry& GetEntry(const uint8_t index)
+        {
+            return _entries[index];
+        }
+
+        /// Returns the estimated 99th percentile cycle count of the profile entry.
+        static uint32_t EstimateP99(const ProfileEntry& entry)
+        {
+            // The rank of the 99th percentile call, rounded up.
+            const uint32_t rank = static_cast<uint32_t>((static_cast<uint64_t>(entry.count) * 99 + 99) / 100);
+
+            uint32_t seen = 0;
+            for (uint8_t bin = 0; bin < 33; ++bin)
+            {
+                seen += entry.histogram[bin];
+                if (seen < rank) continue;
+
+                // The upper bound of bin b is 2^b - 1. The maximum is a tighter bound for the last occupied bin.
+                const uint32_t bound = bin == 0 ? 0 : static_cast<uint32_t>((1ULL << bin) - 1);
+                return bound < entry.maximum ? bound : entry.maximum;
+            }
+            return entry.maximum;
+        }
+
+        /// Discards all profile entries.
+        static void Reset()
+        {
+            for (auto& entry : _entries) entry = ProfileEntry();
+            _size    = 0;
+            _dropped = 0;
+        }
+
+    private:
+        /// Finds the profile entry of the module command, creating it if necessary. Returns nullptr if the table is
+        /// full.
+        static ProfileEntry* Find(const uint8_t module_type, const uint8_t module_id, const uint8_t command)
+        {
+            for (uint8_t i = 0; i < _size; ++i)
+            {
+                ProfileEntry& entry = _entries[i];
+                if (entry.module_type == module_type && entry.module_id == module_id && entry.command == command)
+                {
+                    return &entry;
+                }
+            }
+
+            if (_size == kCapacity) return nullptr;
+            ProfileEntry& entry = _entries[_size++];
+            entry.module_type   = module_type;
+            entry.module_id     = module_id;
+            entry.command       = command;
+            return &entry;
+        }
+
+        /// The profile entries.
+        static inline ProfileEntry _entries[kCapacity];
+
+        /// The number of used profile entries.
+        static inline uint8_t _size = 0;
+
+        /// The number of calls that were not recorded because the profile table was full.
+        static inline uint32_t _dropped = 0;
+};
+
+/// Times the enclosing scope with the DWT cycle counter and records the cycle count when the scope ends.
+class ProfileScope
+{
+    public:
+        ProfileScope(const uint8_t module_type, const uint8_t module_id, const uint8_t command) :
+            _start(ARM_DWT_CYCCNT), _module_type(module_type), _module_id(module_id), _command(command)
+        {}
+
+        ~ProfileScope()
+        {
+            Profiler::Record(_module_type, _module_id, _command, ARM_DWT_CYCCNT - _start);
+        }
+
+        ProfileScope(const ProfileScope&)            = delete;
+        ProfileScope& operator=(const ProfileScope&) = delete;
+
+    private:
+        const uint32_t _start;
+        const uint8_t _module_type;
+        const uint8_t _module_id;
+        const uint8_t _command;
+};
+
+/// Profiles the rest of the enclosing module method as the given command of the module.
+#define AXMC_PROFILE_CALL(command) const ProfileScope axmc_profile_scope(GetModuleType(), GetModuleID(), command)
+
+#else
+
+#define AXMC_PROFILE_CALL(command) static_cast<void>(0)
+
+#endif  // AXMC_PROFILING
+
+#endif  //AXMC_PROFILER_H
@@ -0,0 +1,136 @@
+/**
+ * @file
+ * @brief The header-only file for the ProfilerModule class. This class allows the PC to retrieve the per-module cycle
+ * count statistics collected by the Profiler class (see profiler.h).
+ *
+ * The module is only available in the profiling builds, which define the AXMC_PROFILING macro.
+ *
+ * @section prf_mod_dependencies Dependencies:
+ * - Arduino.h for Arduino platform functions and macros and cross-compatibility with Arduino IDE (to an extent).
+ * - module.h for the shared Module class API access (integrates the custom module into runtime flow).
+ * - profiler.h for the collected cycle count statistics.
+ */
+
+#ifndef AXMC_PROFILER_MODULE_H
+#define AXMC_PROFILER_MODULE_H
+
+#include <cstdint>
+#include <Arduino.h>
+#include <module.h>
+#include "profiler.h"
+
+#ifdef AXMC_PROFILING
+
+/**
+ * @brief Sends the collected profile to the PC.
+ *
+ * The DumpProfile command sends one kProfileEntry message per profile entry, one entry per runtime cycle, so that the
+ * dump does not stall the other modules. Each message is a kSixUint32s array laid out as: [module type << 16 |
+ * module ID << 8 | command, call count, minimum cycles, mean cycles, maximum cycles, estimated 99th percentile cycles].
+ * The dump ends with a kProfileComplete message that carries the number of entries and the number of calls that were
+ * not recorded because the profile table was full. The cycle counts can be converted to microseconds by dividing them
+ * by the CPU frequency in MHz (600 for the default Teensy 4.0 configuration).
+ *
+ * @note The profiler does not profile its own commands.
+ */
+class ProfilerModule final : public Module
+{
+    public:
+
+        /// Assigns meaningful names to byte status-codes used to communicate module events to the PC. Note,
+        /// this enumeration has to use codes 51 through 255 to avoid interfering with shared kCoreStatusCodes
+        /// enumeration inherited from base Module class.
+        enum class kCustomStatusCodes : uint8_t
+        {
+            kProfileEntry    = 51,  ///< Carries the statistics of a single profile entry.
+            kProfileComplete = 52,  ///< All profile entries have been sent.
+        };
+
+        /// Assigns meaningful names to module command byte-codes.
+        enum class kModuleCommands : uint8_t
+        {
+            kDumpProfile  = 1,  ///< Sends all profile entries to the PC.
+            kResetProfile = 2,  ///< Discards all profile entries.
+        };
+
+        /// Initializes the class by subclassing the base Module class.
+        ProfilerModule(const uint8_t module_type, const uint8_t module_id, Communication& communication) :
+            Module(module_type, module_id, communication)
+        {}
+
+        /// The module does not have runtime parameters.
+        bool SetCustomParameters() override
+        {
+            return true;
+        }
+
+        /// Resolves and executes the currently active command.
+        bool RunActiveCommand() override
+        {
+            // Depending on the currently active command, executes the necessary logic.
+            switch (static_cast<kModuleCommands>(GetActiveCommand()))
+            {
+                // DumpProfile
+                case kModuleCommands::kDumpProfile: DumpProfile(); return true;
+                // ResetProfile
+                case kModuleCommands::kResetProfile: ResetProfile(); return true;
+                // Unrecognized command
+                default: return false;
+            }
+        }
+
+        /// Sets up module hardware parameters.
+        bool SetupModule() override
+        {
+            _index = 0;
+            return true;
+        }
+
+        ~ProfilerModule() override = default;
+
+    private:
+        /// The index of the next profile entry to send.
+        uint8_t _index = 0;
+
+        /// Sends the next profile entry to the PC, or completes the command once all entries have been sent.
+        void DumpProfile()
+        {
+            // Starts the dump from the first entry.
+            if (execution_parameters.stage == 1)
+            {
+                _index = 0;
+                AdvanceCommandStage();
+            }
+
+            if (_index < Profiler::GetSize())
+            {
+                const ProfileEntry& entry = Profiler::GetEntry(_index++);
+                const uint32_t summary[6] = {
+                    static_cast<uint32_t>(entry.module_type) << 16 | static_cast<uint32_t>(entry.module_id) << 8 |
+                        entry.command,
+                    entry.count,
+                    entry.minimum,
+                    static_cast<uint32_t>(entry.count == 0 ? 0 : entry.sum / entry.count),
+                    entry.maximum,
+                    Profiler::EstimateP99(entry),
+                };
+                SendData(static_cast<uint8_t>(kCustomStatusCodes::kProfileEntry), kPrototypes::kSixUint32s, summary);
+                return;
+            }
+
+            const uint32_t totals[2] = {Profiler::GetSize(), Profiler::GetDropped()};
+            SendData(static_cast<uint8_t>(kCustomStatusCodes::kProfileComplete), kPrototypes::kTwoUint32s, totals);
+            CompleteCommand();
+        }
+
+        /// Discards all profile entries.
+        void ResetProfile()
+        {
+            Profiler::Reset();
+            CompleteCommand();
+        }
+};
+
+#endif  // AXMC_PROFILING
+
+#endif  //AXMC_PROFILER_MODULE_H
@@ -0,0 +1,169 @@
+/**
+ * @file
+ * @brief The header-only file for the RewardLink class. This class allows a lick sensor to open a reward valve
+ * directly on the microcontroller, without waiting for the PC to react to the lick.
+ *
+ * The PC arms the link with the reward pulse duration, the refractory period and the maximum number of rewards. The
+ * lick sensor then fires the link on every lick onset and the link decides whether the lick qualifies for the reward.
+ * Qualifying licks open the valve immediately, and the valve closes itself after the pulse duration (see the
+ * ValveModule::Deliver() method). The valve does not start the reward while another pulse is in progress, in which
+ * case the lick does not qualify for the reward. The delivered rewards are recorded, so that the owning module can
+ * report them to the PC after the fact. The valve module separately reports the reward pulse itself.
+ *
+ * @note The link can be fired from an interrupt (see adc_watchdog.h), so all state shared with the main runtime loop is
+ * volatile and the link is disarmed while it is being reconfigured.
+ *
+ * @section rwd_lnk_dependencies Dependencies:
+ * - Arduino.h for Arduino platform functions and macros and cross-compatibility with Arduino IDE (to an extent).
+ */
+
+#ifndef AXMC_REWARD_LINK_H
+#define AXMC_REWARD_LINK_H
+
+#include <cstdint>
+#include <Arduino.h>
+
+/// Stores a single reward delivered by the RewardLink class.
+struct RewardRecord
+{
+        uint32_t lick      = 0;  ///< The micros() time of the lick onset that triggered the reward.
+        uint32_t delivered = 0;  ///< The micros() time at which the valve was opened.
+        uint32_t remaining = 0;  ///< The number of rewards left before the link disarms. 0 for unlimited links.
+};
+
+/**
+ * @brief Connects the lick sensor to the reward valve and gates the lick-triggered rewards.
+ *
+ * The valve is attached at compile time by the runtime setup code (see main.cpp), while the PC arms and disarms the
+ * link at runtime through the owning module's commands.
+ */
+class RewardLink
+{
+    public:
+        /// The signature of the function that opens the valve and schedules it to close after the given number of
+        /// microseconds. The function has to be safe to call from an interrupt and return false if the valve could not
+        /// be opened.
+        using Trigger = bool (*)(uint32_t duration);
+
+        /// Attaches the valve that the link opens when it fires.
+        void Attach(const Trigger trigger)
+        {
+            _trigger = trigger;
+        }
+
+        /// Returns true if a valve is attached to the link.
+        [[nodiscard]] bool IsAttached() const
+        {
+            return _trigger != nullptr;
+        }
+
+        /**
+         * @brief Arms the link.
+         *
+         * @param duration the time, in microseconds, to keep the valve open for each reward.
+         * @param refractory the minimum time, in microseconds, between two consecutive rewards.
+         * @param count the number of rewards to deliver before the link disarms itself. 0 means unlimited rewards.
+         * @returns true if the link was armed and false if no valve is attached to the link.
+         */
+        bool Arm(const uint32_t duration, const uint32_t refractory, const uint16_t count)
+        {
+            _armed = false;  // Prevents the interrupt from firing the partially configured link.
+            if (_trigger == nullptr) return false;
+
+            _duration   = duration;
+            _refractory = refractory;
+            _limited    = count != 0;
+            _remaining  = count;
+            _has_fired  = false;
+            _pending    = false;
+            _armed      = true;
+            return true;
+        }
+
+        /// Disarms the link. The rewards that were already delivered can still be retrieved with Read().
+        void Disarm()
+        {
+            _armed = false;
+        }
+
+        /// Returns true if the link is armed.
+        [[nodiscard]] bool IsArmed() const
+        {
+            return _armed;
+        }
+
+        /**
+         * @brief Delivers the reward if the lick qualifies for it.
+         *
+         * @param timestamp the micros() time of the lick onset.
+         * @returns true if the reward was delivered.
+         */
+        bool Fire(const uint32_t timestamp)
+        {
+            if (!_armed || (_has_fired && timestamp - _last_fired < _refractory)) return false;
+
+            if (!_trigger(_duration)) return false;
+            const uint32_t delivered = micros();
+
+            _last_fired = timestamp;
+            _has_fired  = true;
+            if (_limited && --_remaining == 0) _armed = false;
+
+            // Keeps the most recent reward. If the owner does not read the records fast enough, older records are
+            // overwritten. The remaining count allows the PC to detect the gaps.
+            _record.lick      = timestamp;
+            _record.delivered = delivered;
+            _record.remaining = _remaining;
+            _pending          = true;
+            return true;
+        }
+
+        /// Retrieves the most recent delivered reward that has not been read yet. Returns false if there is no such
+        /// reward.
+        bool Read(RewardRecord& record)
+        {
+            if (!_pending) return false;
+
+            // Prevents the interrupt from overwriting the record while it is being copied.
+            noInterrupts();
+            record.lick      = _record.lick;
+            record.delivered = _record.delivered;
+            record.remaining = _record.remaining;
+            _pending         = false;
+            interrupts();
+            return true;
+        }
+
+    private:
+        /// The function that opens the attached valve.
+        Trigger _trigger = nullptr;
+
+        /// The most recent delivered reward.
+        volatile RewardRecord _record;
+
+        /// The time, in microseconds, to keep the valve open for each reward.
+        volatile uint32_t _duration = 0;
+
+        /// The minimum time, in microseconds, between two consecutive rewards.
+        volatile uint32_t _refractory = 0;
+
+        /// The lick onset time of the most recent reward.
+        volatile uint32_t _last_fired = 0;
+
+        /// The number of rewards left before the link disarms.
+        volatile uint16_t _remaining = 0;
+
+        /// Determines whether the number of rewards is limited.
+        volatile bool _limited = false;
+
+        /// Tracks whether the link has delivered at least one reward since it was armed.
+        volatile bool _has_fired = false;
+
+        /// Tracks whether the most recent reward has not been read yet.
+        volatile bool _pending = false;
+
+        /// Tracks whether the link is armed.
+        volatile bool _armed = false;
+};
+
+#endif  //AXMC_REWARD_LINK_H
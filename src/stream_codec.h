@@ -0,0 +1,307 @@
+/**
+ * @file
+ * @brief The header-only file for the DeltaFrameEncoder class and the matching DecodeDeltaFrame() function. Together,
+ * they implement the compressed frame format used to stream slowly changing analog signals to the PC.
+ *
+ * Each frame has a fixed size of kDeltaFrameSize bytes and stores a run of consecutive samples as a full-precision
+ * keyframe sample followed by the differences between each sample and its predecessor. The differences are encoded
+ * using one of two schemes:
+ * - Varint: each difference is zig-zag mapped to an unsigned value and stored as a little-endian base-128 varint. Small
+ * differences (-64 to 63) take a single byte.
+ * - Nibble: each difference is stored as a sequence of 4-bit codes, two codes per byte (low half first). Differences
+ * from -7 to 7 take a single 4-bit two's complement code. The remaining code (0x8) escapes to a wider value: the
+ * next two codes store the difference as an 8-bit two's complement value (-127 to 127), and if that value is -128
+ * (0x80), the next four codes store the sample itself as a raw 16-bit value. Large differences therefore cost 3 or 7
+ * codes, but they never close the frame early.
+ *
+ * The nibble encoding holds up to 101 samples per frame, which caps the compression ratio at about 3.4x. It is the
+ * better choice for the low-noise signals produced by the hardware-averaged ADC readouts. The varint encoding holds up
+ * to 51 samples per frame (about 1.7x) and degrades more gracefully for noisy signals. For the measured ratios of both
+ * encodings on synthetic photometry traces, see test/test_stream_codec.
+ *
+ * The frame layout, in bytes, is: [0-3] the timestamp of the keyframe sample, [4-5] the interval between samples,
+ * [6] the number of samples stored in the frame (including the keyframe), [7] the encoding, [8-9] the keyframe sample,
+ * [10-59] the encoded differences. All multi-byte fields are little-endian. Unused payload bytes are set to zero.
+ *
+ * @note This file only depends on the standard library, so that the decoder can be compiled and used on the host-PC as
+ * the reference implementation of the format.
+ */
+
+#ifndef AXMC_STREAM_CODEC_H
+#define AXMC_STREAM_CODEC_H
+
+#include <cstdint>
+
+/// The size, in bytes, of each encoded frame.
+static constexpr uint8_t kDeltaFrameSize = 60;
+
+/// The size, in bytes, of the encoded frame header (including the keyframe sample).
+static constexpr uint8_t kDeltaFrameHeaderSize = 10;
+
+/// Assigns meaningful names to the supported difference encoding schemes.
+enum class kDeltaEncodings : uint8_t
+{
+    kVarint = 1,  ///< Zig-zag mapped base-128 varints.
+    kNibble = 2,  ///< 4-bit two's complement codes, two per byte, with escapes to wider values.
+};
+
+/**
+ * @brief Packs consecutive samples into fixed-size, delta-encoded frames.
+ *
+ * The frame is stored as an array of 32-bit words, so that it can be sent to the PC using a standard array
+ * prototype. Use Append() to add samples until it returns false or the frame needs to be sent for other reasons,
+ * then use Finalize() to write the frame header and Reset() to start the next frame.
+ */
+class DeltaFrameEncoder
+{
+    public:
+        /// The number of 32-bit words used to store each frame.
+        static constexpr uint8_t kFrameWords = kDeltaFrameSize / 4;
+
+        /// The 4-bit code that escapes to the 8-bit difference in nibble frames.
+        static constexpr uint8_t kNibbleEscape = 0x8;
+
+        /// The 8-bit difference value that escapes to the raw 16-bit sample in nibble frames.
+        static constexpr uint8_t kNibbleRaw = 0x80;
+
+        /// Clears the frame and selects the encoding used by the next frame.
+        void Reset(const kDeltaEncodings encoding)
+        {
+            for (auto& word : _frame) word = 0;
+            _encoding = encoding;
+            _count    = 0;
+            _position = kDeltaFrameHeaderSize;
+            _nibble   = false;
+        }
+
+        /**
+         * @brief Adds the sample to the frame.
+         *
+         * @param sample the sample to add.
+         * @returns true if the sample was added and false if the frame does not have the space to store it. In the
+         * latter case, the frame has to be finalized and reset before the sample can be added.
+         */
+        bool Append(const uint16_t sample)
+        {
+            if (_count == 0)
+            {
+                WriteByte(8, static_cast<uint8_t>(sample));
+                WriteByte(9, static_cast<uint8_t>(sample >> 8));
+                _previous = sample;
+                _count    = 1;
+                return true;
+            }
+
+            const int32_t delta = static_cast<int32_t>(sample) - static_cast<int32_t>(_previous);
+            if (_encoding == kDeltaEncodings::kNibble)
+            {
+                // Resolves the number of 4-bit codes needed to store the difference.
+                const uint8_t codes = delta >= -7 && delta <= 7 ? 1 : delta >= -127 && delta <= 127 ? 3 : 7;
+                const uint8_t free  = static_cast<uint8_t>((kDeltaFrameSize - _position) * 2 - (_nibble ? 1 : 0));
+                if (codes > free) return false;
+
+                if (codes == 1) WriteNibble(static_cast<uint8_t>(delta));
+                else
+                {
+                    WriteNibble(kNibbleEscape);
+                    const auto wide = static_cast<uint8_t>(codes == 3 ? delta : kNibbleRaw);
+                    WriteNibble(wide);
+                    WriteNibble(wide >> 4);
+                    if (codes == 7)
+                    {
+                        for (uint8_t shift = 0; shift < 16; shift += 4)
+                        {
+                            WriteNibble(static_cast<uint8_t>(sample >> shift));
+                        }
+                    }
+                }
+            }
+            else
+            {
+                // Zig-zag mapping moves the sign into the least significant bit, so that small negative differences
+                // also produce small unsigned values. The shift is applied to the unsigned value, as left-shifting a
+                // negative signed value is undefined.
+                auto value = (static_cast<uint32_t>(delta) << 1) ^ static_cast<uint32_t>(delta >> 31);
+                if (_position + VarintSize(value) > kDeltaFrameSize) return false;
+                while (value >= 0x80)
+                {
+                    WriteByte(_position++, static_cast<uint8_t>(value | 0x80));
+                    value >>= 7;
+                }
+                WriteByte(_position++, static_cast<uint8_t>(value));
+            }
+
+            _previous = sample;
+            ++_count;
+            return true;
+        }
+
+        /**
+         * @brief Writes the frame header.
+         *
+         * @param timestamp the timestamp of the keyframe sample.
+         * @param interval the interval between consecutive samples.
+         * @returns the frame, ready to be sent to the PC.
+         */
+        const uint32_t (&Finalize(const uint32_t timestamp, const uint16_t interval))[kFrameWords]
+        {
+            _frame[0] = timestamp;
+            WriteByte(4, static_cast<uint8_t>(interval));
+            WriteByte(5, static_cast<uint8_t>(interval >> 8));
+            WriteByte(6, _count);
+            WriteByte(7, static_cast<uint8_t>(_encoding));
+            return _frame;
+        }
+
+        /// Returns the number of samples stored in the frame.
+        [[nodiscard]] uint8_t GetCount() const
+        {
+            return _count;
+        }
+
+    private:
+        /// Appends the low 4 bits of the value to the nibble frame payload, filling the low half of each byte first.
+        void WriteNibble(const uint8_t value)
+        {
+            const auto bits = static_cast<uint8_t>(value & 0x0F);
+            WriteByte(_position, static_cast<uint8_t>(ReadByte(_position) | (_nibble ? bits << 4 : bits)));
+            if (_nibble) ++_position;
+            _nibble = !_nibble;
+        }
+
+        /// Returns the number of bytes needed to store the value as a varint.
+        static uint8_t VarintSize(const uint32_t value)
+        {
+            return value < (1U << 7) ? 1 : value < (1U << 14) ? 2 : 3;
+        }
+
+        /// Writes the byte at the specified frame offset. Uses explicit shifts so that the frame layout does not
+        /// depend on the platform endianness.
+        void WriteByte(const uint8_t offset, const uint8_t value)
+        {
+            const uint8_t shift = (offset & 3) * 8;
+            _frame[offset >> 2] = (_frame[offset >> 2] & ~(0xFFUL << shift)) | (static_cast<uint32_t>(value) << shift);
+        }
+
+        /// Reads the byte at the specified frame offset.
+        [[nodiscard]] uint8_t ReadByte(const uint8_t offset) const
+        {
+            return static_cast<uint8_t>(_frame[offset >> 2] >> ((offset & 3) * 8));
+        }
+
+        /// Stores the frame being filled.
+        uint32_t _frame[kFrameWords] = {};
+
+        /// The encoding used by the frame.
+        kDeltaEncodings _encoding = kDeltaEncodings::kVarint;
+
+        /// The number of samples stored in the frame.
+        uint8_t _count = 0;
+
+        /// The frame offset of the next payload byte.
+        uint8_t _position = kDeltaFrameHeaderSize;
+
+        /// Tracks whether the next nibble goes into the high half of the current payload byte.
+        bool _nibble = false;
+
+        /// The last sample added to the frame.
+        uint16_t _previous = 0;
+};
+
+/**
+ * @brief Decodes a frame produced by the DeltaFrameEncoder class.
+ *
+ * @param frame the kDeltaFrameSize bytes of the frame, in the order they were received from the microcontroller.
+ * @param samples the array to store the decoded samples in.
+ * @param capacity the number of samples that fit into the samples array.
+ * @param timestamp the variable to store the keyframe sample timestamp in.
+ * @param interval the variable to store the interval between samples in.
+ * @returns the number of decoded samples, or 0 if the frame is malformed or the samples do not fit into the array.
+ */
+inline uint8_t DecodeDeltaFrame(
+    const uint8_t* frame,
+    uint16_t* samples,
+    const uint16_t capacity,
+    uint32_t& timestamp,
+    uint16_t& interval
+)
+{
+    timestamp = static_cast<uint32_t>(frame[0]) | static_cast<uint32_t>(frame[1]) << 8 |
+                static_cast<uint32_t>(frame[2]) << 16 | static_cast<uint32_t>(frame[3]) << 24;
+    interval                = static_cast<uint16_t>(frame[4] | frame[5] << 8);
+    const uint8_t count     = frame[6];
+    const auto encoding     = static_cast<kDeltaEncodings>(frame[7]);
+    if (count == 0 || count > capacity) return 0;
+
+    auto sample = static_cast<uint16_t>(frame[8] | frame[9] << 8);
+    samples[0]  = sample;
+
+    uint8_t position = kDeltaFrameHeaderSize;
+    bool nibble      = false;
+
+    // Reads the next 4-bit code from the nibble frame payload. Returns false if the payload is exhausted.
+    auto read_nibble = [&](uint8_t& bits)
+    {
+        if (position >= kDeltaFrameSize) return false;
+        bits   = nibble ? frame[position++] >> 4 : frame[position] & 0x0F;
+        nibble = !nibble;
+        return true;
+    };
+
+    for (uint8_t i = 1; i < count; ++i)
+    {
+        int32_t delta;
+        if (encoding == kDeltaEncodings::kNibble)
+        {
+            uint8_t bits;
+            if (!read_nibble(bits)) return 0;
+            if (bits != DeltaFrameEncoder::kNibbleEscape)
+            {
+                delta = bits >= 8 ? bits - 16 : bits;  // Sign-extends the 4-bit value.
+            }
+            else
+            {
+                uint8_t low;
+                uint8_t high;
+                if (!read_nibble(low) || !read_nibble(high)) return 0;
+                const auto wide = static_cast<uint8_t>(low | high << 4);
+                if (wide != DeltaFrameEncoder::kNibbleRaw)
+                {
+                    delta = static_cast<int8_t>(wide);  // Sign-extends the 8-bit value.
+                }
+                else
+                {
+                    // Reads the raw sample and converts it into the difference from the previous sample.
+                    uint16_t raw = 0;
+                    for (uint8_t shift = 0; shift < 16; shift += 4)
+                    {
+                        if (!read_nibble(bits)) return 0;
+                        raw = static_cast<uint16_t>(raw | bits << shift);
+                    }
+                    delta = static_cast<int32_t>(raw) - static_cast<int32_t>(sample);
+                }
+            }
+        }
+        else if (encoding == kDeltaEncodings::kVarint)
+        {
+            uint32_t value = 0;
+            uint8_t shift  = 0;
+            uint8_t byte;
+            do
+            {
+                if (position >= kDeltaFrameSize || shift > 14) return 0;
+                byte   = frame[position++];
+                value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+                shift += 7;
+            } while (byte & 0x80);
+            delta = static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);  // Reverses zig-zag mapping.
+        }
+        else return 0;
+
+        sample     = static_cast<uint16_t>(sample + delta);
+        samples[i] = sample;
+    }
+    return count;
+}
+
+#endif  //AXMC_STREAM_CODEC_H
@@ -0,0 +1,166 @@
+/**
+ * @file
+ * @brief The header-only file for the TelemetryModule class. This class allows the PC to monitor the health of the
+ * microcontroller runtime during the session, so that a controller that falls behind is detected while the data is
+ * still being acquired.
+ *
+ * The module reports the main loop frequency, the longest main loop period, the outgoing serial traffic counters
+ * collected by the CountingStream class (see counting_stream.h) and the dispatch, skip and overrun counters of the
+ * scheduled modules (see module_schedule.h). The keepalive messages are handled by the Kernel
+ * class provided by the ataraxis-micro-controller library, so the telemetry is sent as a separate status message. The
+ * PC is expected to run the ReportTelemetry command recurrently at the keepalive interval.
+ *
+ * @section tlm_mod_dependencies Dependencies:
+ * - Arduino.h for Arduino platform functions and macros and cross-compatibility with Arduino IDE (to an extent).
+ * - module.h for the shared Module class API access (integrates the custom module into runtime flow).
+ * - counting_stream.h for the outgoing serial traffic counters.
+ * - module_schedule.h for the scheduled module dispatch, skip and overrun counters.
+ * - profiler.h for the opt-in execution time profiling of the module commands.
+ */
+
+#ifndef AXMC_TELEMETRY_MODULE_H
+#define AXMC_TELEMETRY_MODULE_H
+
+#include <cstdint>
+#include <Arduino.h>
+#include <module.h>
+#include "counting_stream.h"
+#include "module_schedule.h"
+#include "profiler.h"
+
+/**
+ * @brief Measures the main loop timing and reports it to the PC together with the outgoing serial traffic counters.
+ *
+ * The main loop has to call the Tick() method once per iteration (see main.cpp). Each call reads the DWT cycle counter
+ * and updates two counters, so the measurement does not measurably slow down the loop.
+ *
+ * Each ReportTelemetry command sends a kTelemetry message, which is a kNineUint32s array laid out as: [loop
+ * iterations per second, longest loop period (us), transmitted bytes, transmitted messages, stalled messages, dropped
+ * messages, scheduled dispatches, overruns, skipped checks].
+ * All values cover the time since the previous report. The schedule counters only cover the modules that use a
+ * non-zero service period (see module_schedule.h).
+ */
+class TelemetryModule final : public Module
+{
+    public:
+
+        /// Assigns meaningful names to byte status-codes used to communicate module events to the PC. Note,
+        /// this enumeration has to use codes 51 through 255 to avoid interfering with shared kCoreStatusCodes
+        /// enumeration inherited from base Module class.
+        enum class kCustomStatusCodes : uint8_t
+        {
+            kTelemetry = 51,  ///< Carries the runtime telemetry collected since the previous report.
+        };
+
+        /// Assigns meaningful names to module command byte-codes.
+        enum class kModuleCommands : uint8_t
+        {
+            kReportTelemetry = 1,  ///< Sends the runtime telemetry to the PC.
+        };
+
+        /// Initializes the class by subclassing the base Module class.
+        TelemetryModule(
+            const uint8_t module_type,
+            const uint8_t module_id,
+            Communication& communication,
+            CountingStream& stream
+        ) :
+            Module(module_type, module_id, communication),
+            _stream(stream)
+        {}
+
+        /// The module does not have runtime parameters.
+        bool SetCustomParameters() override
+        {
+            return true;
+        }
+
+        /// Resolves and executes the currently active command.
+        bool RunActiveCommand() override
+        {
+            AXMC_PROFILE_CALL(GetActiveCommand());
+
+            // Depending on the currently active command, executes the necessary logic.
+            switch (static_cast<kModuleCommands>(GetActiveCommand()))
+            {
+                // ReportTelemetry
+                case kModuleCommands::kReportTelemetry: ReportTelemetry(); return true;
+                // Unrecognized command
+                default: return false;
+            }
+        }
+
+        /// Sets up module hardware parameters.
+        bool SetupModule() override
+        {
+            // Discards the telemetry collected before the setup, as it does not describe the runtime loop.
+            TrafficCounters counters;
+            _stream.TakeCounters(counters);
+            ModuleSchedule::TakeDispatches();
+            ModuleSchedule::TakeOverruns();
+            ModuleSchedule::TakeSkips();
+            _iterations   = 0;
+            _worst_period = 0;
+            _last_tick    = ARM_DWT_CYCCNT;
+            _window_start = micros();
+            return true;
+        }
+
+        ~TelemetryModule() override = default;
+
+        /// Records a single main loop iteration. Has to be called once per main loop iteration.
+        void Tick()
+        {
+            const uint32_t now    = ARM_DWT_CYCCNT;
+            const uint32_t period = now - _last_tick;
+            _last_tick            = now;
+            if (period > _worst_period) _worst_period = period;
+            ++_iterations;
+        }
+
+    private:
+        /// The stream that counts the outgoing serial traffic.
+        CountingStream& _stream;
+
+        /// The number of main loop iterations since the previous report.
+        uint32_t _iterations = 0;
+
+        /// The longest main loop period, in CPU cycles, since the previous report.
+        uint32_t _worst_period = 0;
+
+        /// The DWT cycle counter value at the previous main loop iteration.
+        uint32_t _last_tick = 0;
+
+        /// The micros() time of the previous report.
+        uint32_t _window_start = 0;
+
+        /// Sends the telemetry collected since the previous report to the PC and starts the next reporting window.
+        void ReportTelemetry()
+        {
+            const uint32_t now     = micros();
+            const uint32_t elapsed = now - _window_start;
+            _window_start          = now;
+
+            TrafficCounters counters;
+            _stream.TakeCounters(counters);
+
+            const uint32_t telemetry[9] = {
+                elapsed == 0 ? 0 : static_cast<uint32_t>(static_cast<uint64_t>(_iterations) * 1000000 / elapsed),
+                _worst_period / (F_CPU_ACTUAL / 1000000),
+                counters.bytes,
+                counters.messages,
+                counters.stalls,
+                counters.drops,
+                ModuleSchedule::TakeDispatches(),
+                ModuleSchedule::TakeOverruns(),
+                ModuleSchedule::TakeSkips(),
+            };
+            _iterations   = 0;
+            _worst_period = 0;
+
+            SendData(static_cast<uint8_t>(kCustomStatusCodes::kTelemetry), kPrototypes::kNineUint32s, telemetry);
+            CompleteCommand();
+        }
+};
+
+#endif  //AXMC_TELEMETRY_MODULE_H
@@ -0,0 +1,283 @@
+/**
+ * @file
+ * @brief The header-only file for the ValveGroup class. This class allows opening and closing several valves managed
+ * by ValveModule instances at the same time, for example, to deliver bilateral rewards.
+ *
+ * The class resolves the fast GPIO port and bit of every valve pin at compile time and merges the pins that share a
+ * port into a single bitmask per port and signal level. Opening or closing the group then takes one write to the
+ * port's set or clear register per used mask, instead of one digitalWriteFast() call per valve in separate module
+ * commands. The valves that share a port and a signal level switch at the same instant. The other valves switch within
+ * a few CPU cycles of each other, as all port writes are issued back to back with the interrupts disabled.
+ *
+ * The group pulse reuses the delivery path of the ValveModule class: every valve has to be idle and allowed by its
+ * own duty cycle governor, every valve's budget is charged for the pulse, and the pulse is timed with the DWT cycle
+ * counter at the port writes. The group pulse is closed by a single one-shot PIT interrupt.
+ *
+ * @attention This file targets the Teensy 4.0 pin layout (pins 0 through 23) and relies on the Teensy core routing the
+ * standard GPIO1-4 ports to the fast GPIO6-9 ports at startup. The group holds one PIT channel while its pulse is in
+ * progress. Since the group pulse is only started while all valves of the group are idle, the valves' own channels are
+ * free at that time.
+ *
+ * @section vlv_grp_dependencies Dependencies:
+ * - Arduino.h for Arduino platform functions and macros and cross-compatibility with Arduino IDE (to an extent).
+ * - IntervalTimer.h for the Teensy PIT channel management class used to close the valves after the group pulse.
+ * - valve_module.h for the governed valve delivery state of the grouped valves.
+ */
+
+#ifndef AXMC_VALVE_GROUP_H
+#define AXMC_VALVE_GROUP_H
+
+#include <cstdint>
+#include <Arduino.h>
+#include <IntervalTimer.h>
+#include "valve_module.h"
+
+/**
+ * @brief Resolves the fast GPIO port connected to the Teensy 4.0 digital pin.
+ *
+ * @param pin the digital pin number.
+ * @returns the fast GPIO port number (6, 7 or 9) or 0 if the pin is not supported.
+ */
+constexpr uint8_t ResolveGpioPort(const uint8_t pin)
+{
+    // Pins 0 to 23.
+    constexpr uint8_t kPorts[] = {6, 6, 9, 9, 9, 9, 7, 7, 7, 7, 7, 7, 7, 7, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6};
+    return pin <= 23 ? kPorts[pin] : 0;
+}
+
+/**
+ * @brief Resolves the bit of the fast GPIO port connected to the Teensy 4.0 digital pin.
+ *
+ * @param pin the digital pin number.
+ * @returns the port bit number or 0 if the pin is not supported.
+ */
+constexpr uint8_t ResolveGpioBit(const uint8_t pin)
+{
+    // Pins 0 to 23.
+    constexpr uint8_t kBits[] = {3, 2, 4, 5, 6, 8, 10, 17, 16, 11, 0, 2, 1, 3, 18, 19, 23, 22, 17, 16, 26, 27, 24, 25};
+    return pin <= 23 ? kBits[pin] : 0;
+}
+
+/**
+ * @brief Opens and closes a group of valves with back-to-back GPIO port writes.
+ *
+ * The group is linked to the leading valve with ValveModule::LinkGroup(), and the leading valve's SendGroupPulse
+ * command starts the group pulse. The leading valve reports the group pulse with its kPulseComplete message. Since all
+ * valves are opened by the same port writes and closed by the same port writes, the reported width applies to every
+ * valve in the group.
+ *
+ * If one of the valves is taken over by its own ToggleOn or ToggleOff command during the group pulse, it leaves the
+ * group pulse, and the closing interrupt only closes the remaining valves.
+ *
+ * @tparam Leader the type of the ValveModule instance whose command starts the group pulse.
+ * @tparam Partners the types of the other ValveModule instances in the group.
+ */
+template <class Leader, class... Partners>
+class ValveGroup
+{
+        // Ensures that the group has at least two valves.
+        static_assert(sizeof...(Partners) >= 1, "ValveGroup requires at least two valves.");
+
+        // Ensures that all pins can be resolved to their GPIO ports.
+        static_assert(
+            ResolveGpioPort(Leader::kPin) != 0 && ((ResolveGpioPort(Partners::kPin) != 0) && ...),
+            "ValveGroup pins have to be Teensy 4.0 digital pins (0 through 23)."
+        );
+
+        // Ensures that every valve of the group uses a different pin.
+        static_assert(
+            ((Leader::kPin != Partners::kPin) && ...) && [] {
+                constexpr uint8_t kPinArray[] = {Partners::kPin...};
+                for (uint8_t i = 0; i < sizeof(kPinArray); ++i)
+                {
+                    for (uint8_t j = i + 1; j < sizeof(kPinArray); ++j)
+                    {
+                        if (kPinArray[i] == kPinArray[j]) return false;
+                    }
+                }
+                return true;
+            }(),
+            "ValveGroup valves have to use different pins."
+        );
+
+        /// The outcomes of the group pulse start attempts, which use the leading valve's result codes.
+        using Results = typename Leader::kDeliveryResults;
+
+    public:
+        /**
+         * @brief Opens all valves of the group and starts the one-shot PIT timer that closes them after the
+         * requested number of microseconds.
+         *
+         * The group pulse is only started if no valve of the group is delivering a pulse or toggled on, and the
+         * governors of all valves allow it. Like ValveModule pulses, the checks, the port writes and the budget
+         * charges run with the interrupts disabled.
+         *
+         * @param duration the time, in microseconds, to keep the valves open.
+         * @returns the outcome of the attempt. The valves are only opened if the pulse was started.
+         */
+        static Results StartDelivery(const uint32_t duration)
+        {
+            if (duration == 0) return Results::kRejected;  // IntervalTimer cannot time zero-length pulses.
+
+            noInterrupts();
+            const Results result = Launch(duration);
+            interrupts();
+            return result;
+        }
+
+    private:
+        /// The number of fast GPIO ports that can be connected to the Teensy 4.0 digital pins (GPIO6, GPIO7 and
+        /// GPIO9).
+        static constexpr uint8_t kPortCount = 3;
+
+        /// The port selection that includes all valves of the group.
+        static constexpr uint32_t kAllValves[kPortCount] = {UINT32_MAX, UINT32_MAX, UINT32_MAX};
+
+        /// Manages the PIT channel that closes the valves at the end of the group pulse.
+        static inline IntervalTimer _timer;
+
+        /// Tracks whether the group pulse is in progress.
+        static inline volatile bool _delivering = false;
+
+        /// Resolves the index of the fast GPIO port in the port selection arrays.
+        static constexpr uint8_t PortIndex(const uint8_t port)
+        {
+            return port == 9 ? 2 : port - 6;
+        }
+
+        /// Returns the port bitmask of the valve pin.
+        template <class Valve>
+        static constexpr uint32_t Bit()
+        {
+            return 1U << ResolveGpioBit(Valve::kPin);
+        }
+
+        /// Returns the bitmask of the valve on the fast GPIO port if the valve is opened (or closed) by driving its pin
+        /// to the level, and 0 otherwise.
+        template <class Valve>
+        static constexpr uint32_t ValveMask(const uint8_t port, const bool level, const bool opening)
+        {
+            const bool signal = opening ? Valve::kOpen : Valve::kClose;
+            return ResolveGpioPort(Valve::kPin) == port && signal == level ? Bit<Valve>() : 0;
+        }
+
+        /// Returns the bitmask of the group valves on the fast GPIO port that are opened (or closed) by driving their
+        /// pins to the level.
+        static constexpr uint32_t Mask(const uint8_t port, const bool level, const bool opening)
+        {
+            return ValveMask<Leader>(port, level, opening) | (ValveMask<Partners>(port, level, opening) | ...);
+        }
+
+        /// Returns the set register of the fast GPIO port.
+        template <uint8_t kPort>
+        static volatile uint32_t& SetRegister()
+        {
+            if constexpr (kPort == 6) return GPIO6_DR_SET;
+            else if constexpr (kPort == 7) return GPIO7_DR_SET;
+            else return GPIO9_DR_SET;
+        }
+
+        /// Returns the clear register of the fast GPIO port.
+        template <uint8_t kPort>
+        static volatile uint32_t& ClearRegister()
+        {
+            if constexpr (kPort == 6) return GPIO6_DR_CLEAR;
+            else if constexpr (kPort == 7) return GPIO7_DR_CLEAR;
+            else return GPIO9_DR_CLEAR;
+        }
+
+        /// Writes the masks of the selected valves on the fast GPIO port to the port's set and clear registers. The
+        /// writes of the masks that do not contain any group valve are removed at compile time.
+        template <uint8_t kPort, bool kOpening>
+        static void WritePort(const uint32_t selected)
+        {
+            constexpr uint32_t kSet   = Mask(kPort, HIGH, kOpening);
+            constexpr uint32_t kClear = Mask(kPort, LOW, kOpening);
+            if constexpr (kSet != 0) SetRegister<kPort>() = kSet & selected;
+            if constexpr (kClear != 0) ClearRegister<kPort>() = kClear & selected;
+        }
+
+        /// Opens (or closes) the selected valves with back-to-back port writes. Has to be called with the interrupts
+        /// disabled.
+        template <bool kOpening>
+        static void WritePorts(const uint32_t (&selected)[kPortCount])
+        {
+            WritePort<6, kOpening>(selected[PortIndex(6)]);
+            WritePort<7, kOpening>(selected[PortIndex(7)]);
+            WritePort<9, kOpening>(selected[PortIndex(9)]);
+        }
+
+        /// Adds the valve to the port selection if it still delivers the group pulse.
+        template <class Valve>
+        static void Select(uint32_t (&selected)[kPortCount])
+        {
+            if (!Valve::_delivering || !Valve::_grouped) return;
+            selected[PortIndex(ResolveGpioPort(Valve::kPin))] |= Bit<Valve>();
+        }
+
+        /// Adds the governor decision of the valve to the group decision.
+        template <class Decision>
+        static void Tally(const Decision decision, bool& reject, bool& defer)
+        {
+            reject = reject || decision == Decision::kReject;
+            defer  = defer || decision == Decision::kDefer;
+        }
+
+        /// Runs the governors of all valves and, if they allow the pulse, opens the valves and starts the timer that
+        /// closes them. Has to be called with the interrupts disabled (see StartDelivery()).
+        static Results Launch(const uint32_t duration)
+        {
+            if (_delivering || Leader::_delivering || Leader::_latched ||
+                ((Partners::_delivering || Partners::_latched) || ...))
+            {
+                return Results::kDeferred;
+            }
+
+            // Every governor has to allow the pulse. A rejection by any governor rejects the group pulse.
+            bool reject = false;
+            bool defer  = false;
+            Tally(Leader::Govern(duration), reject, defer);
+            (Tally(Partners::Govern(duration), reject, defer), ...);
+            if (reject) return Results::kRejected;
+            if (defer) return Results::kDeferred;
+
+            // Opens the valves immediately before starting the timer, so that the pulse width only includes the timer
+            // start and the closing interrupt latencies.
+            Leader::PrepareGroupOpen();
+            (Partners::PrepareGroupOpen(), ...);
+            WritePorts<true>(kAllValves);
+            const uint32_t open_cycles = ARM_DWT_CYCCNT;  // Captured right after the last port write.
+            const uint32_t open_time   = micros();
+            _timer.priority(48);  // Matches the ValveModule closing interrupt priority.
+            if (!_timer.begin(CloseDelivery, duration))
+            {
+                WritePorts<false>(kAllValves);
+                return Results::kNoTimer;
+            }
+
+            // Since the interrupts are disabled, the closing interrupt cannot run before the state is updated.
+            _delivering = true;
+            Leader::BeginDelivery(duration, false, true, open_cycles, open_time);
+            (Partners::BeginDelivery(duration, false, true, open_cycles, open_time), ...);
+            return Results::kStarted;
+        }
+
+        /// Closes the valves that still deliver the group pulse. Called by the one-shot PIT interrupt.
+        static void CloseDelivery()
+        {
+            // Disables the interrupts, so that the higher-priority interrupts cannot separate the port writes.
+            noInterrupts();
+            uint32_t selected[kPortCount] = {};
+            Select<Leader>(selected);
+            (Select<Partners>(selected), ...);
+            WritePorts<false>(selected);
+            const uint32_t close_cycles = ARM_DWT_CYCCNT;  // Captured right after the last port write.
+            Leader::FinishGroupDelivery(close_cycles);
+            (Partners::FinishGroupDelivery(close_cycles), ...);
+            _timer.end();
+            _delivering = false;
+            interrupts();
+        }
+};
+
+#endif  //AXMC_VALVE_GROUP_H
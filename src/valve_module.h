@@ -8,6 +8,12 @@
  * - digitalWriteFast.h for fast digital pin manipulation methods.
  * - module.h for the shared Module class API access (integrates the custom module into runtime flow).
  * - shared_assets.h for globally shared static message byte-codes and parameter structures.
+ * - IntervalTimer.h for the Teensy PIT channel management class used to close the valve after the reward pulses.
+ * - parameter_store.h for restoring the runtime parameters committed to the emulated EEPROM.
+ * - profiler.h for the opt-in execution time profiling of the module commands.
+ *
+ * @note The SendGroupPulse command additionally requires the valve_group.h header, which implements the linked valve
+ * groups (see LinkGroup()).
  */
 
 #ifndef AXMC_VALVE_MODULE_H
@@ -15,7 +21,14 @@
 
 #include <Arduino.h>
 #include <digitalWriteFast.h>
+#include <IntervalTimer.h>
 #include <module.h>
+#include "parameter_store.h"
+#include "profiler.h"
+
+// Opens and closes several ValveModule instances together. Defined in valve_group.h.
+template <class Leader, class... Partners>
+class ValveGroup;
 
 /**
  * @brief Sends digital signals to dispense precise amounts of fluid via the managed solenoid valve.
@@ -24,6 +37,39 @@
  * hardware to deliver voltage that opens or closes the controlled valve. Depending on configuration, this module is
  * designed to work with both Normally Closed (NC) and Normally Open (NO) valves.
  *
+ * The valve pulses are timed by a one-shot Periodic Interrupt Timer (PIT) channel that closes the valve from its
+ * interrupt. The Kernel is only involved in opening the valve and in reporting the pulse once it ends, so the pulse
+ * width, and therefore the dispensed volume, does not depend on the runtime cycle duration. Zero-length pulses are
+ * treated as no-ops and never open the valve.
+ *
+ * @attention The Teensy 4.0 has 4 PIT channels, shared by all IntervalTimer instances. Each ValveModule instantiation
+ * (a unique valve pin) has its own timer, which holds a channel only while its pulse is in progress. The AdcStream
+ * class holds another channel while the analog stream runs. If all channels are busy, the pulse is not started and the
+ * pulse command is aborted after sending the kTimerUnavailable message. See main.cpp for the channel budget of the
+ * runtime layout.
+ *
+ * Optionally, the valve can be driven in the peak-and-hold mode. In this mode, the valve is opened with the full
+ * voltage for the kick_duration, which overcomes the armature inertia as fast as possible, and then kept open with the
+ * lower hold_duty PWM duty cycle, which reduces the coil current and heating for the rest of the pulse. The PWM is
+ * generated by the FlexPWM or QuadTimer module connected to the pin (via analogWrite()). The switch from the kick to
+ * the hold phase is made by the Service() method, which the main loop calls once per iteration (see main.cpp), so the
+ * PWM module is never reconfigured from an interrupt. The kick phase therefore lasts at least kick_duration and at
+ * most one main loop iteration longer, which only adds to the opening force. The PIT interrupt still closes the valve
+ * on time by routing the pin back from the PWM module to the GPIO port (see RouteToGpio()).
+ *
+ * All valve openings, including the lick-triggered rewards, pass through a token-bucket governor that protects the
+ * solenoid from overheating and the rig from flooding. The valve can stay open for at most governor_budget
+ * microseconds in any governor_window, and consecutive pulses have to be separated by at least pulse_gap microseconds.
+ * The pulses requested by the PC commands wait until the governor allows them for at most defer_timeout microseconds,
+ * and are rejected if they exceed the budget or time out. The lick-triggered rewards are rejected if they cannot be
+ * delivered immediately. The ToggleOn command keeps the valve open until the ToggleOff command, and no pulses are
+ * started in the meantime. While the governor is enabled, the open time of the toggled-on valve is charged against the
+ * budget, and Service() force-closes the valve with the kClosed and kGovernorRejected messages once the budget runs
+ * out. The ToggleOn command is rejected if there is no budget left.
+ *
+ * The valve can also be linked with other valves into a group (see LinkGroup() and valve_group.h). The SendGroupPulse
+ * command then opens and closes all valves of the group with back-to-back GPIO port writes. The group pulse passes
+ * through the governor of every valve in the group and is reported by this valve with a single kPulseComplete message.
  *
  * @note This class was calibrated to work with fluid valves that deliver microliter-precise amounts of fluid under
  * gravitational driving force. The current class implementation may not work as intended for other use cases.
@@ -37,12 +83,16 @@
  * @tparam kStartClosed determines the initial state of the valve during class initialization. This works
  * together with kNormallyClosed parameter to deliver the desired initial voltage level for the valve to either be
  * opened or closed after hardware initialization.
+ * @tparam kPeakAndHold determines whether to drive the valve in the peak-and-hold mode. Requires a Normally Closed
+ * valve connected to a PWM-capable pin. Note, the PWM frequency is shared by all pins connected to the same FlexPWM
+ * submodule or QuadTimer, so these pins should not be used for other PWM outputs.
  */
 template <
     const uint8_t kValvePin,
     const bool kNormallyClosed,
-    const bool kStartClosed = true>
-    
+    const bool kStartClosed = true,
+    const bool kPeakAndHold = false>
+
 class ValveModule final : public Module
 {
         // Ensures that the valve pin does not interfere with the LED pin.
@@ -52,6 +102,13 @@ class ValveModule final : public Module
             "instance."
         );
 
+        // Ensures that the peak-and-hold mode is only used with valves that are energized to open and can be
+        // driven with PWM.
+        static_assert(
+            !kPeakAndHold || (kNormallyClosed && digitalPinHasPWM(kValvePin)),
+            "The peak-and-hold mode requires a Normally Closed valve connected to a PWM-capable pin."
+        );
+
     public:
 
         /// Assigns meaningful names to byte status-codes used to communicate module events to the PC. Note,
@@ -62,6 +119,13 @@ class ValveModule final : public Module
             kOpen                     = 51,  ///< The valve is currently open.
             kClosed                   = 52,  ///< The valve is currently closed.
             kCalibrated               = 53,  ///< The valve calibration cycle has been completed.
+            kCalibrationProgress      = 54,  ///< The valve calibration cycle has delivered another batch of pulses.
+            kScheduleComplete         = 55,  ///< The reward schedule has been played out.
+            kParametersRestored       = 56,  ///< The runtime parameters were restored from the emulated EEPROM.
+            kPulseComplete            = 57,  ///< The valve pulse has ended. Carries the pulse start time and width.
+            kGovernorRejected         = 58,  ///< The duty cycle governor rejected the opening or closed the valve.
+            kTimerUnavailable         = 59,  ///< No PIT channel was available to time the valve pulse.
+            kStoreRefused             = 60,  ///< The parameters were not stored, as the valve is open.
         };
 
         /// Assigns meaningful names to module command byte-codes.
@@ -71,6 +135,10 @@ class ValveModule final : public Module
             kToggleOn  = 2,  ///< Sets the valve to be permanently open.
             kToggleOff = 3,  ///< Sets the valve to be permanently closed.
             kCalibrate = 4,  ///< Repeatedly pulses the valve to map different pulse_durations to dispensed fluid volumes.
+            kRunSchedule = 5,  ///< Plays out the pulse train stored in the schedule parameters.
+            kDeliverVolume = 6,  ///< Delivers the requested_volume of fluid using the calibration curve.
+            kStoreParameters = 7,  ///< Commits the current runtime parameters to the emulated EEPROM.
+            kSendGroupPulse = 8,  ///< Pulses all valves of the linked group at the same time for the pulse_duration.
         };
 
         /// Initializes the class by subclassing the base Module class.
@@ -86,24 +154,38 @@ class ValveModule final : public Module
         /// reception buffer.
         bool SetCustomParameters() override
         {
+            AXMC_PROFILE_CALL(0);
+
             // Attempts to extract the received parameters
-            return _communication.ExtractModuleParameters(_custom_parameters);
+            if (!_communication.ExtractModuleParameters(_custom_parameters)) return false;
+            ApplySharedParameters();
+            return true;
         }
 
         /// Resolves and executes the currently active command.
         bool RunActiveCommand() override
         {
+            AXMC_PROFILE_CALL(GetActiveCommand());
+
             // Depending on the currently active command, executes the necessary logic.
             switch (static_cast<kModuleCommands>(GetActiveCommand()))
             {
                 // Pulse
-                case kModuleCommands::kSendPulse: Pulse(); return true;
+                case kModuleCommands::kSendPulse: Pulse(_custom_parameters.pulse_duration); return true;
                 // Open
                 case kModuleCommands::kToggleOn: Open(); return true;
                 // Close
                 case kModuleCommands::kToggleOff: Close(); return true;
                 // Calibrate
                 case kModuleCommands::kCalibrate: Calibrate(); return true;
+                // RunSchedule
+                case kModuleCommands::kRunSchedule: RunSchedule(); return true;
+                // DeliverVolume
+                case kModuleCommands::kDeliverVolume: DeliverVolume(); return true;
+                // StoreParameters
+                case kModuleCommands::kStoreParameters: StoreParameters(); return true;
+                // GroupPulse
+                case kModuleCommands::kSendGroupPulse: Pulse(_custom_parameters.pulse_duration, true); return true;
                 // Unrecognized command
                 default: return false;
             }
@@ -115,32 +197,145 @@ class ValveModule final : public Module
             // Sets the valve state based on the configuration of the valve's FET gate and the desired initial
             // state.
             pinModeFast(kValvePin, OUTPUT);
+            if constexpr (kPeakAndHold) analogWriteFrequency(kValvePin, kHoldFrequency);
             if (kStartClosed)
             {
                 digitalWriteFast(kValvePin, kClose);  // Ensures the valve is closed.
+                _latched = false;
                 SendData(static_cast<uint8_t>(kCustomStatusCodes::kClosed));
             }
             else
             {
-                digitalWriteFast(kValvePin, kOpen);  // Ensures the valve is open.
+                DriveOpen();  // Ensures the valve is open.
+                _latched     = true;
+                _charge_time = micros();
                 SendData(static_cast<uint8_t>(kCustomStatusCodes::kOpen));
             }
 
             // Resets the custom_parameters structure fields to their default values.
             _custom_parameters.pulse_duration    = 35000;  // ~ 5.0 uL of water in the current Sun lab system.
             _custom_parameters.calibration_count = 200;    // The valve is pulsed 500 times during calibration.
+            _custom_parameters.schedule_size     = 0;      // The schedule is empty until the PC loads it.
+            for (auto& entry : _custom_parameters.schedule) entry = {};
+            _custom_parameters.curve_size        = 0;      // The calibration curve is empty until the PC loads it.
+            for (auto& point : _custom_parameters.curve) point = {};
+            _custom_parameters.requested_volume  = 5000;
+            _custom_parameters.kick_duration     = 3000;   // Only used in the peak-and-hold mode
+            _custom_parameters.hold_duty         = 96;     // ~38% of the full coil voltage
+            _custom_parameters.governor_budget   = 15000000;  // Limits the valve to 25% duty cycle
+            _custom_parameters.governor_window   = 60000000;
+            _custom_parameters.pulse_gap         = 10000;
+            _custom_parameters.defer_timeout     = 60000000;  // Allows the governor to replenish the full budget
+
+            // Replaces the defaults with the parameters committed to the emulated EEPROM, if they are valid, and
+            // notifies the PC that it does not need to resend them.
+            if (ParameterStore::Load(_store_address, GetModuleType(), GetModuleID(), _custom_parameters))
+            {
+                SendData(static_cast<uint8_t>(kCustomStatusCodes::kParametersRestored));
+            }
+            ApplySharedParameters();
 
             return true;
         }
 
+        /// Performs the valve work that has to happen in the main loop outside the module commands: reports the
+        /// lick-triggered rewards, enforces the governor budget of the toggled-on valve and switches the
+        /// peak-and-hold valve from the kick to the hold phase. Has to be called once per main loop iteration (see
+        /// main.cpp).
+        void Service()
+        {
+            ReportRewards();
+            EnforceBudget();
+
+            if constexpr (kPeakAndHold)
+            {
+                // Checks and switches the phase with the interrupts disabled, so that the closing interrupt cannot
+                // close the valve between the check and the analogWrite() call, which would reopen it.
+                noInterrupts();
+                if (_kicking && micros() - _kick_start >= _kick_duration)
+                {
+                    analogWrite(kValvePin, _hold_duty);  // Routes the pin to the PWM module.
+                    _kicking = false;
+                }
+                interrupts();
+            }
+        }
+
+        /**
+         * @brief Opens the valve for the lick-triggered reward and closes it after the requested number of
+         * microseconds without involving the Kernel.
+         *
+         * This method is the trigger of the RewardLink class (see reward_link.h) and is safe to call from an
+         * interrupt. The reward pulse takes the same path as the pulses started by the module commands (see
+         * StartDelivery()), and Service() reports it to the PC with a single kPulseComplete message once the valve
+         * closes. The message carries the opening time and the width of the pulse (see RecordPulse()).
+         *
+         * @param duration the time, in microseconds, to keep the valve open.
+         * @returns true if the pulse was started and false otherwise. In the latter case, the valve is not opened.
+         */
+        static bool Deliver(const uint32_t duration)
+        {
+            return StartDelivery(duration, true) == kDeliveryResults::kStarted;
+        }
+
+        /**
+         * @brief Links the valves that the SendGroupPulse command opens and closes together with this valve.
+         *
+         * This method has to be called by the runtime setup code before the Kernel is set up, and requires the
+         * valve_group.h header. The linked valves stay individually addressable by their own commands, and the group
+         * pulse is only started when all valves of the group are idle.
+         *
+         * @tparam Partners the types of the ValveModule instances to link.
+         */
+        template <class... Partners>
+        void LinkGroup(Partners&...)
+        {
+            _group_delivery = ValveGroup<ValveModule, Partners...>::StartDelivery;
+        }
+
         ~ValveModule() override = default;
 
     private:
+        // Allows the valve groups to open and close this valve through its governed delivery.
+        template <class Leader, class... Partners>
+        friend class ValveGroup;
+
+        /// Stores the maximum number of pulses in the reward schedule.
+        static constexpr uint8_t kMaxScheduleSize = 8;
+
+        /// Stores a single pulse of the reward schedule.
+        struct ScheduleEntry
+        {
+                uint32_t delay    = 0;  ///< The time, in microseconds, to wait after the previous pulse ends.
+                uint32_t duration = 0;  ///< The time, in microseconds, to keep the valve open.
+        } PACKED_STRUCT;
+
+        /// Stores the maximum number of points in the calibration curve.
+        static constexpr uint8_t kMaxCurvePoints = 8;
+
+        /// Stores a single point of the calibration curve.
+        struct CurvePoint
+        {
+                uint32_t volume   = 0;  ///< The dispensed volume, in nanoliters.
+                uint32_t duration = 0;  ///< The pulse duration, in microseconds, that dispenses the volume.
+        } PACKED_STRUCT;
+
         /// Stores the instance's addressable runtime parameters.
         struct CustomRuntimeParameters
         {
                 uint32_t pulse_duration    = 35000;   ///< The time, in microseconds, to keep the valve open.
                 uint16_t calibration_count = 200;     ///< The number of times to pulse the valve during calibration.
+                uint8_t schedule_size      = 0;       ///< The number of used reward schedule entries.
+                ScheduleEntry schedule[kMaxScheduleSize];  ///< The reward schedule pulses, in the playback order.
+                uint8_t curve_size         = 0;       ///< The number of used calibration curve points.
+                CurvePoint curve[kMaxCurvePoints];    ///< The calibration curve points, in the ascending volume order.
+                uint32_t requested_volume  = 5000;    ///< The volume, in nanoliters, to dispense with DeliverVolume.
+                uint32_t kick_duration     = 3000;    ///< The time, in microseconds, to open the valve at full voltage.
+                uint8_t hold_duty          = 96;      ///< The 8-bit PWM duty cycle used to hold the valve open.
+                uint32_t governor_budget   = 15000000;  ///< The open time, in us, allowed per window. 0 disables.
+                uint32_t governor_window   = 60000000;  ///< The time, in us, over which the budget is replenished.
+                uint32_t pulse_gap         = 10000;     ///< The minimum time, in us, between two valve openings.
+                uint32_t defer_timeout     = 60000000;  ///< The maximum time, in us, a pulse waits for the governor.
         } PACKED_STRUCT _custom_parameters;
 
         /// Stores the digital signal that needs to be sent to the valve pin to open the valve.
@@ -149,81 +344,794 @@ class ValveModule final : public Module
         /// Stores the digital signal that needs to be sent to the valve pin to close the valve.
         static constexpr bool kClose = kNormallyClosed ? LOW : HIGH;  // NOLINT(*-dynamic-static-initializers)
 
+        /// Stores the valve pin for use by the ValveGroup class.
+        static constexpr uint8_t kPin = kValvePin;
+
         /// Stores the time, in microseconds, that must separate any two consecutive pulses during the valve
         /// calibration. The value for this attribute is hardcoded for the system's safety, as pulsing the
         /// valve too fast may generate undue stress in the calibrated hydraulic system.
         static constexpr uint32_t kCalibrationDelay = 300000;
 
-        /// Cycles opening and closing the valve to deliver the precise amount of fluid.
-        void Pulse()
+        /// Stores the number of calibration pulses between two consecutive progress reports.
+        static constexpr uint16_t kCalibrationReportInterval = 20;
+
+        /// Tracks the number of pulses delivered by the active calibration cycle.
+        uint16_t _calibration_pulses = 0;
+
+        /// The emulated EEPROM address of the module's parameter record.
+        uint16_t _store_address = ParameterStore::kInvalidAddress;
+
+        /// Stores the pulse duration resolved from the requested volume by the active DeliverVolume command.
+        uint32_t _volume_pulse_duration = 0;
+
+        /// Tracks the index of the next reward schedule entry to play out.
+        uint8_t _schedule_index = 0;
+
+        /// Stores the micros() time at which the reward schedule started.
+        uint32_t _schedule_start = 0;
+
+        /// Stores the micros() time at which the previous reward schedule pulse ended.
+        uint32_t _schedule_mark = 0;
+
+        /// Accumulates the valve open time, in microseconds, of the reward schedule pulses.
+        uint32_t _schedule_open_time = 0;
+
+        /// Manages the PIT channel that closes the valve at the end of each pulse.
+        static inline IntervalTimer _delivery_timer;
+
+        /// Tracks whether a pulse is in progress.
+        static inline volatile bool _delivering = false;
+
+        /// The PWM frequency, in Hz, used in the hold phase. The frequency is above the audible range to prevent the
+        /// valve from whining.
+        static constexpr float kHoldFrequency = 20000.0F;
+
+        /// Stores the kick_duration of the peak-and-hold mode for use by the static pulse methods.
+        static inline volatile uint32_t _kick_duration = 3000;
+
+        /// Stores the hold_duty of the peak-and-hold mode for use by the static pulse methods.
+        static inline volatile uint8_t _hold_duty = 96;
+
+        /// Tracks whether the valve is in the kick phase of the peak-and-hold mode.
+        static inline volatile bool _kicking = false;
+
+        /// Stores the micros() time at which the kick phase started.
+        static inline volatile uint32_t _kick_start = 0;
+
+        /// The IOMUX register value that routes the pin to the GPIO port: ALT5 (GPIO) with the SION bit set, which
+        /// matches the value written by pinMode().
+        static constexpr uint32_t kGpioMux = 5 | 0x10;
+
+        /// Defines the decisions of the duty cycle governor.
+        enum class kGovernorDecisions : uint8_t
+        {
+            kAllow  = 0,  ///< The valve can be opened for the requested duration.
+            kDefer  = 1,  ///< The valve can be opened for the requested duration later.
+            kReject = 2,  ///< The requested duration exceeds the governor budget.
+        };
+
+        /// Defines the outcomes of the StartDelivery() calls.
+        enum class kDeliveryResults : uint8_t
+        {
+            kStarted  = 0,  ///< The pulse was started.
+            kDeferred = 1,  ///< The pulse can be started later, as the valve is busy or the governor deferred it.
+            kRejected = 2,  ///< The pulse has zero length or exceeds the governor budget.
+            kNoTimer  = 3,  ///< No PIT channel was available to time the pulse.
+        };
+
+        /// Stores the DWT and micros() timestamps of a single pulse.
+        struct PulseTiming
+        {
+                uint32_t open_time    = 0;  ///< The micros() time at which the valve was opened.
+                uint32_t open_cycles  = 0;  ///< The DWT cycle counter value captured when the valve was opened.
+                uint32_t close_time   = 0;  ///< The micros() time at which the valve was closed.
+                uint32_t close_cycles = 0;  ///< The DWT cycle counter value captured when the valve was closed.
+        };
+
+        /// Stores the timestamps of the last pulse started by the module commands.
+        static inline volatile PulseTiming _command_timing;
+
+        /// Stores the timestamps of the last lick-triggered reward pulse.
+        static inline volatile PulseTiming _reward_timing;
+
+        /// Tracks whether the pulse in progress is a lick-triggered reward.
+        static inline volatile bool _reward = false;
+
+        /// Tracks whether the pulse in progress is a group pulse, which is closed by the ValveGroup timer.
+        static inline volatile bool _grouped = false;
+
+        /// Tracks whether the last pulse started by the module commands was cancelled by the ToggleOn command instead
+        /// of being closed by the timer.
+        static inline volatile bool _cancelled = false;
+
+        /// The number of lick-triggered reward pulses ended since the runtime start.
+        static inline volatile uint32_t _reward_closes = 0;
+
+        /// The number of reward pulse ends reported by Service().
+        uint32_t _reported_closes = 0;
+
+        /// Stores the governor_budget for use by the static pulse methods.
+        static inline volatile uint32_t _governor_budget = 0;
+
+        /// Stores the governor_window for use by the static pulse methods.
+        static inline volatile uint32_t _governor_window = 0;
+
+        /// Stores the pulse_gap for use by the static pulse methods.
+        static inline volatile uint32_t _pulse_gap = 0;
+
+        /// The remaining open time budget, in microseconds.
+        static inline volatile uint32_t _tokens = 0;
+
+        /// The micros() time at which the budget was last replenished.
+        static inline volatile uint32_t _refill_time = 0;
+
+        /// The micros() time at which the valve was last closed.
+        static inline volatile uint32_t _closed_time = 0;
+
+        /// Tracks whether the valve is held open by the ToggleOn command.
+        static inline volatile bool _latched = false;
+
+        /// The micros() time up to which the open time of the toggled-on valve was charged against the budget.
+        static inline volatile uint32_t _charge_time = 0;
+
+        /// Stores the micros() time from which the pulse of the active command is due.
+        uint32_t _pulse_due = 0;
+
+        /// Starts the pulse of the linked valve group. Set by LinkGroup().
+        kDeliveryResults (*_group_delivery)(uint32_t duration) = nullptr;
+
+        /// Copies the peak-and-hold and governor parameters used by the static pulse methods. Changing the governor
+        /// parameters refills the budget.
+        void ApplySharedParameters() const
+        {
+            _kick_duration = _custom_parameters.kick_duration;
+            _hold_duty     = _custom_parameters.hold_duty;
+
+            // The governor state is also used by the pulses started from an interrupt.
+            noInterrupts();
+            if (_governor_budget != _custom_parameters.governor_budget ||
+                _governor_window != _custom_parameters.governor_window)
+            {
+                _governor_budget = _custom_parameters.governor_budget;
+                _governor_window = _custom_parameters.governor_window;
+                _tokens          = _governor_budget;
+                _refill_time     = micros();
+                _charge_time     = _refill_time;
+            }
+            _pulse_gap = _custom_parameters.pulse_gap;
+            interrupts();
+        }
+
+        /// Replenishes the open time budget in proportion to the time elapsed since the last replenishment and
+        /// returns the available budget. Has to be called with the interrupts disabled.
+        static uint32_t Refill()
+        {
+            const uint32_t now     = micros();
+            const uint32_t elapsed = now - _refill_time;
+            const uint64_t added   = _governor_window == 0 ? _governor_budget :
+                                     static_cast<uint64_t>(elapsed) * _governor_budget / _governor_window;
+
+            // Only moves the replenishment time when at least one microsecond of budget was added, so that frequent
+            // calls do not discard the fractional budget.
+            if (added != 0)
+            {
+                const uint64_t tokens = _tokens + added;
+                _tokens               = tokens > _governor_budget ? _governor_budget : static_cast<uint32_t>(tokens);
+                _refill_time          = now;
+            }
+            return _tokens;
+        }
+
+        /// Decides whether the valve can be opened for the requested duration. Runs in constant time. Has to be called
+        /// with the interrupts disabled.
+        static kGovernorDecisions Govern(const uint32_t duration)
+        {
+            if (_governor_budget == 0) return kGovernorDecisions::kAllow;
+            if (duration > _governor_budget) return kGovernorDecisions::kReject;
+            if (micros() - _closed_time < _pulse_gap || Refill() < duration)
+            {
+                return kGovernorDecisions::kDefer;
+            }
+            return kGovernorDecisions::kAllow;
+        }
+
+        /**
+         * @brief Starts the governed pulse for the active command.
+         *
+         * If the valve is busy or the governor defers the pulse, the command stays at the current stage and retries
+         * during the next runtime cycle. If the governor rejects the pulse, or the pulse is still deferred
+         * defer_timeout microseconds after it was due, the PC is notified and the command is aborted. The command is
+         * also aborted, with the kTimerUnavailable message, if no PIT channel is available, as the pulse width would
+         * otherwise depend on the runtime cycle duration.
+         *
+         * @param duration the time, in microseconds, to keep the valve open.
+         * @param due the micros() time from which the pulse is due.
+         * @param grouped determines whether to pulse all valves of the linked group instead of this valve alone.
+         * @returns true if the pulse was started and false otherwise.
+         */
+        bool StartPulse(const uint32_t duration, const uint32_t due, const bool grouped = false)
+        {
+            switch (grouped ? _group_delivery(duration) : StartDelivery(duration, false))
+            {
+                case kDeliveryResults::kStarted: return true;
+                case kDeliveryResults::kDeferred:
+                    if (micros() - due < _custom_parameters.defer_timeout) return false;
+                    [[fallthrough]];
+                case kDeliveryResults::kRejected:
+                    SendData(static_cast<uint8_t>(kCustomStatusCodes::kGovernorRejected));
+                    AbortCommand();
+                    return false;
+                default:
+                    SendData(static_cast<uint8_t>(kCustomStatusCodes::kTimerUnavailable));
+                    AbortCommand();
+                    return false;
+            }
+        }
+
+        /**
+         * @brief Opens the valve and starts the one-shot PIT timer that closes it after the requested number of
+         * microseconds.
+         *
+         * The valve is closed by the PIT interrupt, so the pulse width does not depend on how long the Kernel takes to
+         * cycle through the modules. The pulses are started both by the module commands and by the lick-triggered
+         * rewards, which can fire from an interrupt (see adc_watchdog.h). Therefore, the busy check, the governor
+         * decision, the pulse start and the budget charge run with the interrupts disabled, and a pulse is never
+         * started while another pulse is in progress.
+         *
+         * @param duration the time, in microseconds, to keep the valve open.
+         * @param reward determines whether the pulse is a lick-triggered reward, which is reported by Service().
+         * @returns the outcome of the attempt. The valve is only opened if the pulse was started.
+         */
+        static kDeliveryResults StartDelivery(const uint32_t duration, const bool reward)
+        {
+            if (duration == 0) return kDeliveryResults::kRejected;  // IntervalTimer cannot time zero-length pulses.
+
+            // Note, interrupts() also re-enables the interrupts when this runs in an interrupt. This is correct, as the
+            // interrupts that fire the rewards do not disable the interrupts themselves.
+            noInterrupts();
+            const kDeliveryResults result = Launch(duration, reward);
+            interrupts();
+            return result;
+        }
+
+        /// Runs the governor and, if it allows the pulse, opens the valve and starts the timer that closes it. Has to
+        /// be called with the interrupts disabled (see StartDelivery()).
+        static kDeliveryResults Launch(const uint32_t duration, const bool reward)
+        {
+            if (_delivering || _latched) return kDeliveryResults::kDeferred;
+            const kGovernorDecisions decision = Govern(duration);
+            if (decision == kGovernorDecisions::kDefer) return kDeliveryResults::kDeferred;
+            if (decision == kGovernorDecisions::kReject) return kDeliveryResults::kRejected;
+
+            // Opens the valve immediately before starting the timer, so that the pulse width only includes the timer
+            // start and the closing interrupt latencies. The fast write has no effect while the pin is routed to the
+            // PWM module.
+            if constexpr (kPeakAndHold) RouteToGpio();
+            digitalWriteFast(kValvePin, kOpen);
+            const uint32_t open_cycles = ARM_DWT_CYCCNT;  // Captured right after the pin write.
+            const uint32_t open_time   = micros();
+            _delivery_timer.priority(48);  // Keeps the closing latency low without preempting the ADC interrupts.
+            if (!_delivery_timer.begin(CloseDelivery, duration))
+            {
+                digitalWriteFast(kValvePin, kClose);
+                return kDeliveryResults::kNoTimer;
+            }
+
+            // Since the interrupts are disabled, the closing interrupt cannot run before the state is updated.
+            BeginDelivery(duration, reward, false, open_cycles, open_time);
+            return kDeliveryResults::kStarted;
+        }
+
+        /**
+         * @brief Records the start of the pulse whose valve was just opened and charges the pulse against the
+         * governor budget. Has to be called with the interrupts disabled.
+         *
+         * @param duration the time, in microseconds, the valve is kept open.
+         * @param reward determines whether the pulse is a lick-triggered reward.
+         * @param grouped determines whether the pulse is a group pulse, which is closed by the ValveGroup timer.
+         * @param open_cycles the DWT cycle counter value captured right after the pin write that opened the valve.
+         * @param open_time the micros() time at which the valve was opened.
+         */
+        static void BeginDelivery(
+            const uint32_t duration,
+            const bool reward,
+            const bool grouped,
+            const uint32_t open_cycles,
+            const uint32_t open_time
+        )
+        {
+            volatile PulseTiming& timing = reward ? _reward_timing : _command_timing;
+            timing.open_cycles           = open_cycles;
+            timing.open_time             = open_time;
+            _delivering                  = true;
+            _reward                      = reward;
+            _grouped                     = grouped;
+            if (!reward) _cancelled = false;
+            if (_governor_budget != 0) _tokens -= duration;
+
+            // In the peak-and-hold mode, Service() switches the valve to the hold phase once the kick phase ends.
+            // Pulses that are not longer than the kick phase are delivered with the full voltage.
+            if (kPeakAndHold && duration > _kick_duration)
+            {
+                _kick_start = open_time;
+                _kicking    = true;
+            }
+        }
+
+        /// Prepares the valve to be opened by the ValveGroup port write. In the peak-and-hold mode, this routes the
+        /// pin back from the PWM module to the GPIO port. Has to be called with the interrupts disabled.
+        static void PrepareGroupOpen()
+        {
+            if constexpr (kPeakAndHold) RouteToGpio();
+        }
+
+        /// Ends the group pulse of the valve, whose pin was closed by the ValveGroup port write at close_cycles. Does
+        /// nothing if the valve no longer delivers the group pulse, for example, because the ToggleOn command took it
+        /// over. Has to be called by the ValveGroup closing interrupt with the interrupts disabled.
+        static void FinishGroupDelivery(const uint32_t close_cycles)
+        {
+            if (!_delivering || !_grouped) return;
+            if constexpr (kPeakAndHold)
+            {
+                RouteToGpio();
+                _kicking = false;
+            }
+            _closed_time = micros();
+            FinishDelivery(close_cycles);
+        }
+
+        /// Routes the pin from the PWM module back to the GPIO port. analogWrite() only changes the pin's IOMUX
+        /// register, and the GPIO direction and pad settings configured by SetupModule() are kept, so restoring this
+        /// single register is equivalent to pinMode(OUTPUT). Unlike pinMode(), this does not read-modify-write the
+        /// shared GPIO direction register, so it is safe to call from an interrupt.
+        static void RouteToGpio()
+        {
+            *portConfigRegister(kValvePin) = kGpioMux;
+        }
+
+        /// Drives the closing signal to the valve pin. In the peak-and-hold mode, this also routes the pin back from
+        /// the PWM module to the GPIO port, which outputs the closing signal written just before. Safe to call from an
+        /// interrupt. Returns the DWT cycle counter value captured right after the pin write.
+        static uint32_t WriteClosed()
+        {
+            digitalWriteFast(kValvePin, kClose);
+            const uint32_t cycles = ARM_DWT_CYCCNT;  // Captured before the routing and micros() calls.
+            if constexpr (kPeakAndHold)
+            {
+                RouteToGpio();
+                _kicking = false;
+            }
+            _closed_time = micros();
+            return cycles;
+        }
+
+        /// Opens the valve until it is closed by the ToggleOff command. In the peak-and-hold mode, Service() switches
+        /// the valve to the hold phase after the kick phase.
+        static void DriveOpen()
+        {
+            if constexpr (kPeakAndHold) RouteToGpio();
+            digitalWriteFast(kValvePin, kOpen);
+            if constexpr (kPeakAndHold)
+            {
+                _kick_start = micros();
+                _kicking    = true;
+            }
+        }
+
+        /// Closes the valve at the end of the pulse. Called by the one-shot PIT interrupt.
+        static void CloseDelivery()
+        {
+            FinishDelivery(WriteClosed());
+        }
+
+        /// Records the end of the pulse in progress and releases the PIT channel. Has to be called by the closing
+        /// interrupt or with the interrupts disabled, right after WriteClosed(), whose cycle counter value is passed
+        /// as close_cycles.
+        static void FinishDelivery(const uint32_t close_cycles)
+        {
+            volatile PulseTiming& timing = _reward ? _reward_timing : _command_timing;
+            timing.close_cycles          = close_cycles;
+            timing.close_time            = _closed_time;
+            if (_reward) ++_reward_closes;
+            _delivery_timer.end();
+            _delivering = false;
+            _reward     = false;
+            _grouped    = false;
+        }
+
+        /**
+         * @brief Resolves the pulse record sent with the kPulseComplete message.
+         *
+         * The record is laid out as: [the micros() time of the opening, the pulse width in whole microseconds, the
+         * sub-microsecond remainder of the width in nanoseconds]. The width is measured with the DWT cycle counter at
+         * the pin writes. The 32-bit cycle counter difference wraps after ~7.1 seconds at 600 MHz, so pulses longer
+         * than half of that are measured with micros() instead and report a zero remainder.
+         *
+         * @param timing the timestamps of the pulse.
+         * @param record the array to store the pulse record in.
+         */
+        static void RecordPulse(const volatile PulseTiming& timing, uint32_t (&record)[3])
+        {
+            const uint32_t cycles_per_micro = F_CPU_ACTUAL / 1000000;
+            const uint32_t elapsed          = timing.close_time - timing.open_time;
+            record[0]                       = timing.open_time;
+            if (elapsed < UINT32_MAX / cycles_per_micro / 2)
+            {
+                const uint32_t cycles = timing.close_cycles - timing.open_cycles;
+                record[1]             = cycles / cycles_per_micro;
+                record[2]             = cycles % cycles_per_micro * 1000 / cycles_per_micro;
+            }
+            else
+            {
+                record[1] = elapsed;
+                record[2] = 0;
+            }
+        }
+
+        /// Charges the open time of the toggled-on valve since the previous charge against the budget and returns the
+        /// remaining budget. Has to be called with the interrupts disabled.
+        static uint32_t ChargeLatched()
+        {
+            Refill();
+            const uint32_t now     = micros();
+            const uint32_t elapsed = now - _charge_time;
+            _charge_time           = now;
+            _tokens                = elapsed >= _tokens ? 0 : _tokens - elapsed;
+            return _tokens;
+        }
+
+        /// Force-closes the toggled-on valve once its open time exhausts the governor budget. The valve can stay open
+        /// for up to one main loop iteration past the budget.
+        void EnforceBudget()
+        {
+            if (!_latched || _governor_budget == 0) return;
+
+            noInterrupts();
+            const bool exhausted = ChargeLatched() == 0;
+            if (exhausted)
+            {
+                WriteClosed();
+                _latched = false;
+            }
+            interrupts();
+
+            if (exhausted)
+            {
+                SendData(static_cast<uint8_t>(kCustomStatusCodes::kClosed));
+                SendData(static_cast<uint8_t>(kCustomStatusCodes::kGovernorRejected));
+            }
+        }
+
+        /// Ends the pulse in progress without closing the valve, so that the PIT interrupt does not close the valve
+        /// opened by the ToggleOn command. As the valve stays open, the pulse is not recorded as closed: a cancelled
+        /// reward is never reported, and the command that started a cancelled pulse is aborted (see AwaitPulse()).
+        /// Has to be called with the interrupts disabled.
+        static void CancelDelivery()
+        {
+            if (!_delivering) return;
+            _delivery_timer.end();
+            if (!_reward) _cancelled = true;
+            _delivering = false;
+            _reward     = false;
+            _grouped    = false;
+        }
+
+        /// Returns true once the timer closed the pulse started by the active command. Aborts the command and returns
+        /// false if the ToggleOn command cancelled the pulse instead, as the valve is then still open.
+        bool AwaitPulse()
+        {
+            if (_delivering) return false;
+            if (_cancelled)
+            {
+                AbortCommand();
+                return false;
+            }
+            return true;
+        }
+
+        /// Reports the lick-triggered reward pulses that ended since the previous call with a single kPulseComplete
+        /// message each, like the pulses of the module commands. If several rewards ended between two calls, only the
+        /// last one is reported. The RewardLink records allow the PC to detect such gaps.
+        void ReportRewards()
+        {
+            if (_reward_closes == _reported_closes) return;
+
+            // Copies the counter and the pulse timestamps with the interrupts disabled, as the next reward can start
+            // from an interrupt.
+            noInterrupts();
+            _reported_closes = _reward_closes;
+            uint32_t record[3];
+            RecordPulse(_reward_timing, record);
+            interrupts();
+
+            SendData(static_cast<uint8_t>(kCustomStatusCodes::kPulseComplete), kPrototypes::kThreeUint32s, record);
+        }
+
+        /// Cycles opening and closing the valve to deliver the precise amount of fluid. The duration is only used
+        /// when the command starts. Once the valve closes, the PC receives a single kPulseComplete message (see
+        /// RecordPulse()). A zero duration completes the command without opening the valve. If grouped is true, all
+        /// valves of the linked group are pulsed, and the command is aborted if no group is linked.
+        void Pulse(const uint32_t duration, const bool grouped = false)
         {
             switch (execution_parameters.stage)
             {
-                // Opens the valve
+                // Marks the pulse as due.
                 case 1:
-                    digitalWriteFast(kValvePin, kOpen);
-                    SendData(static_cast<uint8_t>(kCustomStatusCodes::kOpen));
-
+                    if (grouped && _group_delivery == nullptr)
+                    {
+                        AbortCommand();
+                        return;
+                    }
+                    if (duration == 0)
+                    {
+                        CompleteCommand();
+                        return;
+                    }
+                    _pulse_due = micros();
                     AdvanceCommandStage();
                     return;
 
-                // Waits for the requested valve pulse duration of microseconds to pass.
+                // Opens the valve and starts the timer that closes it once the governor allows the pulse.
                 case 2:
-                    if (!WaitForMicros(_custom_parameters.pulse_duration)) return;
+                    if (!StartPulse(duration, _pulse_due, grouped)) return;
                     AdvanceCommandStage();
                     return;
 
-                // Closes the valve
+                // Waits for the timer to close the valve and reports the pulse.
                 case 3:
-                    digitalWriteFast(kValvePin, kClose);
-                    SendData(static_cast<uint8_t>(kCustomStatusCodes::kClosed));
+                {
+                    if (!AwaitPulse()) return;
+
+                    uint32_t record[3];
+                    RecordPulse(_command_timing, record);
+                    SendData(
+                        static_cast<uint8_t>(kCustomStatusCodes::kPulseComplete),
+                        kPrototypes::kThreeUint32s,
+                        record
+                    );
                     CompleteCommand();
                     return;
+                }
 
                 default: AbortCommand();
             }
         }
 
-        /// Opens the valve.
+        /// Converts the requested_volume into the pulse duration using the calibration curve and pulses the valve.
+        /// Aborts the command if the curve is not valid or the volume is outside the calibrated range.
+        void DeliverVolume()
+        {
+            if (execution_parameters.stage == 1 &&
+                !ResolvePulseDuration(_custom_parameters.requested_volume, _volume_pulse_duration))
+            {
+                AbortCommand();
+                return;
+            }
+            Pulse(_volume_pulse_duration);
+        }
+
+        /**
+         * @brief Converts the volume into the pulse duration by piecewise-linear interpolation between the calibration
+         * curve points.
+         *
+         * The curve has to contain at least two points with strictly increasing volumes and non-decreasing durations.
+         * The volumes outside the calibrated range are rejected instead of extrapolated, as the valve response is
+         * usually not linear near the minimal opening time.
+         *
+         * @param volume the volume to dispense, in nanoliters.
+         * @param duration the variable to store the resolved pulse duration, in microseconds, in.
+         * @returns true if the duration was resolved and false otherwise.
+         */
+        bool ResolvePulseDuration(const uint32_t volume, uint32_t& duration) const
+        {
+            const uint8_t size = _custom_parameters.curve_size;
+            if (size < 2 || size > kMaxCurvePoints) return false;
+
+            const CurvePoint* curve = _custom_parameters.curve;
+            for (uint8_t i = 1; i < size; ++i)
+            {
+                if (curve[i].volume <= curve[i - 1].volume || curve[i].duration < curve[i - 1].duration) return false;
+            }
+            if (volume < curve[0].volume || volume > curve[size - 1].volume) return false;
+
+            // Finds the segment that contains the volume and interpolates within it. The products are computed in
+            // 64 bits and rounded to the nearest microsecond.
+            uint8_t i = 1;
+            while (volume > curve[i].volume) ++i;
+            const uint64_t span   = curve[i].volume - curve[i - 1].volume;
+            const uint64_t offset = volume - curve[i - 1].volume;
+            const uint64_t rise   = curve[i].duration - curve[i - 1].duration;
+            duration = curve[i - 1].duration + static_cast<uint32_t>((rise * offset + span / 2) / span);
+            return true;
+        }
+
+        /// Commits the current runtime parameters to the emulated EEPROM, so that they are restored when the
+        /// microcontroller resets. Aborts the command if the EEPROM does not have enough free space. Since the flash
+        /// write delays the closing interrupt (see parameter_store.h), the command is also aborted, with the
+        /// kStoreRefused message, while a pulse is in progress or the valve is toggled on.
+        void StoreParameters()
+        {
+            if (_delivering || _latched)
+            {
+                SendData(static_cast<uint8_t>(kCustomStatusCodes::kStoreRefused));
+                AbortCommand();
+                return;
+            }
+            if (!ParameterStore::Save(_store_address, GetModuleType(), GetModuleID(), _custom_parameters))
+            {
+                AbortCommand();
+                return;
+            }
+            CompleteCommand();
+        }
+
+        /// Opens the valve and keeps it open until the ToggleOff command or, while the governor is enabled, until
+        /// the open time exhausts the budget (see EnforceBudget()). Takes over the pulse in progress, if any, which is
+        /// then cancelled instead of completed (see CancelDelivery()).
         void Open()
         {
-            digitalWriteFast(kValvePin, kOpen);
+            // If the governor rejects the opening, the pulse in progress, if any, is left to the timer to close.
+            noInterrupts();
+            const bool allowed = _latched || _governor_budget == 0 || Refill() != 0;
+            if (allowed && !_latched)
+            {
+                CancelDelivery();
+                DriveOpen();
+                _latched     = true;
+                _charge_time = micros();
+            }
+            interrupts();
+
+            if (!allowed)
+            {
+                SendData(static_cast<uint8_t>(kCustomStatusCodes::kGovernorRejected));
+                AbortCommand();
+                return;
+            }
             SendData(static_cast<uint8_t>(kCustomStatusCodes::kOpen));
             CompleteCommand();
         }
 
-        /// Closes the valve.
+        /// Closes the valve. The pulse in progress, if any, ends at this closing and is reported with the shortened
+        /// width.
         void Close()
         {
-            digitalWriteFast(kValvePin, kClose);
+            noInterrupts();
+            if (_latched && _governor_budget != 0) ChargeLatched();
+            _latched                    = false;
+            const uint32_t close_cycles = WriteClosed();
+            if (_delivering) FinishDelivery(close_cycles);
+            interrupts();
             SendData(static_cast<uint8_t>(kCustomStatusCodes::kClosed));
             CompleteCommand();
         }
 
+        /// Plays out the reward schedule loaded through the custom parameters. Each entry waits for its delay after
+        /// the previous pulse ends (or the command starts) and then pulses the valve for its duration. The PC is
+        /// notified once, after the last pulse ends, with the number of delivered pulses, the total valve open time and
+        /// the total schedule duration.
+        void RunSchedule()
+        {
+            switch (execution_parameters.stage)
+            {
+                // Validates the schedule and resets the playback state
+                case 1:
+                    if (_custom_parameters.schedule_size > kMaxScheduleSize)
+                    {
+                        AbortCommand();
+                        return;
+                    }
+                    _schedule_index     = 0;
+                    _schedule_open_time = 0;
+                    _schedule_start     = micros();
+                    _schedule_mark      = _schedule_start;
+                    AdvanceCommandStage();
+                    return;
+
+                // Waits for the entry delay to pass and starts the pulse. Completes the command once all entries are
+                // played out.
+                case 2:
+                {
+                    if (_schedule_index == _custom_parameters.schedule_size)
+                    {
+                        const uint32_t summary[3] = {_schedule_index, _schedule_open_time, micros() - _schedule_start};
+                        SendData(
+                            static_cast<uint8_t>(kCustomStatusCodes::kScheduleComplete),
+                            kPrototypes::kThreeUint32s,
+                            summary
+                        );
+                        CompleteCommand();
+                        return;
+                    }
+
+                    // The zero-length entries only contribute their delay.
+                    const ScheduleEntry& entry = _custom_parameters.schedule[_schedule_index];
+                    if (micros() - _schedule_mark < entry.delay) return;
+                    if (entry.duration != 0 && !StartPulse(entry.duration, _schedule_mark + entry.delay)) return;
+                    AdvanceCommandStage();
+                    return;
+                }
+
+                // Waits for the timer to close the valve and moves to the next entry.
+                case 3:
+                    if (!AwaitPulse()) return;
+                    _schedule_mark = micros();
+                    _schedule_open_time += _custom_parameters.schedule[_schedule_index].duration;
+                    ++_schedule_index;
+                    execution_parameters.stage = 2;
+                    return;
+
+                default: AbortCommand();
+            }
+        }
+
         /// Opens the valve for the requested pulse_duration microseconds and repeats the procedure for the
-        /// calibration_count repetitions without blocking or (majorly) delaying.
+        /// calibration_count repetitions. Like Pulse(), the command is staged, so when it is executed in the
+        /// non-blocking mode, the other modules keep running during calibration. The PC is notified about the progress
+        /// every kCalibrationReportInterval pulses.
         void Calibrate()
         {
             // Essentially runs the modified Pulse() command for the requested number of repetitions.
-            for (uint16_t i = 0; i < _custom_parameters.calibration_count; ++i)
+            switch (execution_parameters.stage)
             {
-                // Opens the valve
-                digitalWriteFast(kValvePin, kOpen);
+                // Resets the pulse counter. There is nothing to calibrate if the valve would not be opened.
+                case 1:
+                    _calibration_pulses = 0;
+                    if (_custom_parameters.calibration_count == 0 || _custom_parameters.pulse_duration == 0)
+                    {
+                        SendData(static_cast<uint8_t>(kCustomStatusCodes::kCalibrated));
+                        CompleteCommand();
+                        return;
+                    }
+                    _pulse_due = micros();
+                    AdvanceCommandStage();
+                    return;
 
-                // Blocks in-place until the pulse duration passes.
-                delayMicroseconds(_custom_parameters.pulse_duration);
+                // Opens the valve and starts the timer that closes it once the governor allows the pulse.
+                case 2:
+                    if (!StartPulse(_custom_parameters.pulse_duration, _pulse_due)) return;
+                    AdvanceCommandStage();
+                    return;
 
-                // Closes the valve
-                digitalWriteFast(kValvePin, kClose);
+                // Waits for the timer to close the valve.
+                case 3:
+                    if (!AwaitPulse()) return;
+                    AdvanceCommandStage();
+                    return;
 
-                // Blocks for kCalibrationDelay of microseconds to ensure the valve closes before initiating the next
-                // cycle.
-                delayMicroseconds(kCalibrationDelay);
-            }
+                // Counts the pulse and, if necessary, reports the calibration progress.
+                case 4:
+                    ++_calibration_pulses;
+                    if (_calibration_pulses % kCalibrationReportInterval == 0 &&
+                        _calibration_pulses < _custom_parameters.calibration_count)
+                    {
+                        SendData(
+                            static_cast<uint8_t>(kCustomStatusCodes::kCalibrationProgress),
+                            kPrototypes::kOneUint16,
+                            _calibration_pulses
+                        );
+                    }
+                    AdvanceCommandStage();
+                    return;
 
-            // This command completes after running the requested number of cycles.
-            SendData(static_cast<uint8_t>(kCustomStatusCodes::kCalibrated));
-            CompleteCommand();
+                // Waits for kCalibrationDelay of microseconds to ensure the valve closes before initiating the next
+                // cycle. Then, either loops back to opening the valve or completes the command.
+                case 5:
+                    if (!WaitForMicros(kCalibrationDelay)) return;
+                    if (_calibration_pulses < _custom_parameters.calibration_count)
+                    {
+                        _pulse_due                 = micros();
+                        execution_parameters.stage = 2;
+                        return;
+                    }
+
+                    // This command completes after running the requested number of cycles.
+                    SendData(static_cast<uint8_t>(kCustomStatusCodes::kCalibrated));
+                    CompleteCommand();
+                    return;
+
+                default: AbortCommand();
+            }
         }
 
 };
@@ -0,0 +1,127 @@
+// Verifies the frequency response of the CicDecimator: unity DC gain, the passband flatness with and without the
+// droop-compensating FIR filter and the rejection of the components that alias into the passband. Run with:
+// pio test -e native -f test_decimator
+
+#include <unity.h>
+#include <cmath>
+#include <cstdint>
+#include <initializer_list>
+#include "decimator.h"
+
+namespace
+{
+    /// The number of output samples analyzed by each measurement. All tested frequencies complete a whole number of
+    /// periods over this many output samples.
+    constexpr uint16_t kOutputs = 2000;
+
+    /// The amplitude of the test signals, in ADC units.
+    constexpr double kAmplitude = 1000.0;
+
+    /// Decimates a sine wave centered on the 12-bit mid-scale and returns the amplitude of the output component at
+    /// the frequency the input folds to, relative to the input amplitude.
+    ///
+    /// @param frequency the input frequency, as a fraction of the output rate.
+    double MeasureGain(const uint16_t ratio, const bool compensate, const double frequency)
+    {
+        CicDecimator decimator;
+        decimator.Configure(ratio, compensate);
+
+        // Resolves the output frequency the input folds to.
+        double folded = std::fmod(frequency, 1.0);
+        if (folded > 0.5) folded = 1.0 - folded;
+
+        double in_phase   = 0.0;
+        double quadrature = 0.0;
+        uint16_t count    = 0;
+        for (uint32_t n = 0; count < kOutputs; ++n)
+        {
+            const double value = 2048.0 + kAmplitude * std::cos(2.0 * M_PI * frequency * n / ratio);
+            uint16_t output;
+            if (!decimator.Add(static_cast<uint16_t>(std::lround(value)), output)) continue;
+            in_phase += output * std::cos(2.0 * M_PI * folded * count);
+            quadrature += output * std::sin(2.0 * M_PI * folded * count);
+            ++count;
+        }
+        return 2.0 * std::hypot(in_phase, quadrature) / kOutputs / kAmplitude;
+    }
+}  // namespace
+
+void setUp()
+{}
+
+void tearDown()
+{}
+
+/// Passes a constant input through unchanged once the filter delay lines fill up.
+void test_dc_gain()
+{
+    for (const uint16_t ratio : {2, 10, 100, 1000})
+    {
+        for (const bool compensate : {false, true})
+        {
+            CicDecimator decimator;
+            decimator.Configure(ratio, compensate);
+            TEST_ASSERT_TRUE(decimator.IsEnabled());
+
+            uint16_t output  = 0;
+            uint16_t outputs = 0;
+            for (uint32_t n = 0; n < 50U * ratio; ++n)
+            {
+                if (decimator.Add(3000, output))
+                {
+                    TEST_ASSERT_EQUAL_UINT16(3000, output);
+                    ++outputs;
+                }
+            }
+            TEST_ASSERT_GREATER_THAN(0, outputs);
+        }
+    }
+}
+
+/// Keeps the compensated passband within 2.5% up to 0.2 of the output rate, where the CIC filter alone droops by 18%.
+void test_passband_flatness()
+{
+    for (const uint16_t ratio : {10, 100})
+    {
+        for (const double frequency : {0.05, 0.1, 0.15, 0.2})
+        {
+            TEST_ASSERT_FLOAT_WITHIN(0.025, 1.0, MeasureGain(ratio, true, frequency));
+        }
+        TEST_ASSERT_FLOAT_WITHIN(0.01, 0.82, MeasureGain(ratio, false, 0.2));
+    }
+}
+
+/// Attenuates the components near multiples of the output rate, which fold into the passband.
+void test_alias_rejection()
+{
+    for (const uint16_t ratio : {10, 100})
+    {
+        for (const bool compensate : {false, true})
+        {
+            // These components fold to 0.1 and 0.2 of the output rate.
+            TEST_ASSERT_LESS_THAN_FLOAT(0.005f, static_cast<float>(MeasureGain(ratio, compensate, 0.9)));
+            TEST_ASSERT_LESS_THAN_FLOAT(0.005f, static_cast<float>(MeasureGain(ratio, compensate, 1.9)));
+            TEST_ASSERT_LESS_THAN_FLOAT(0.02f, static_cast<float>(MeasureGain(ratio, compensate, 0.8)));
+        }
+    }
+}
+
+/// Verifies that ratios of 0 and 1 disable the decimator.
+void test_disabled()
+{
+    CicDecimator decimator;
+    decimator.Configure(1, true);
+    TEST_ASSERT_FALSE(decimator.IsEnabled());
+    decimator.Configure(0, false);
+    TEST_ASSERT_FALSE(decimator.IsEnabled());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_dc_gain);
+    RUN_TEST(test_passband_flatness);
+    RUN_TEST(test_alias_rejection);
+    RUN_TEST(test_disabled);
+    return UNITY_END();
+}
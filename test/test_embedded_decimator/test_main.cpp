@@ -0,0 +1,112 @@
+// Benchmarks the CicDecimator on the Teensy 4.0 (Cortex-M7 at 600 MHz) in CPU cycles per input sample, which
+// determines the highest input rate the decimator can keep up with. The cycles are counted with the DWT cycle counter,
+// the same way as by the Profiler class (see profiler.h). Run with: pio test -e teensy40 -f test_embedded_decimator
+
+#include <Arduino.h>
+#include <unity.h>
+#include "decimator.h"
+
+namespace
+{
+    /// The number of input samples decimated by each benchmark.
+    constexpr uint32_t kSamples = 100000;
+
+    /// The number of distinct input samples. The input cycles through them, so that the samples are read from
+    /// memory like the stream samples are, but the input fits into the data cache.
+    constexpr uint16_t kInputSize = 1024;
+
+    /// Stores the benchmark input: a triangle wave spanning the 12-bit ADC range.
+    uint16_t input[kInputSize];
+
+    /// Stores the last output sample, so that the compiler cannot remove the decimation.
+    volatile uint16_t sink;
+
+    /// Decimates kSamples input samples and returns the average number of CPU cycles spent per input sample, in
+    /// hundredths of a cycle. The loop overhead measured without the decimator is subtracted from the result.
+    uint32_t MeasureCycles(const uint16_t ratio, const bool compensate)
+    {
+        CicDecimator decimator;
+        decimator.Configure(ratio, compensate);
+        uint16_t output = 0;
+
+        // Measures the loop overhead.
+        uint32_t start = ARM_DWT_CYCCNT;
+        for (uint32_t i = 0; i < kSamples; ++i)
+        {
+            output = static_cast<uint16_t>(output + input[i % kInputSize]);
+            __asm__ volatile("" ::: "memory");
+        }
+        const uint32_t overhead = ARM_DWT_CYCCNT - start;
+        sink                    = output;
+
+        start = ARM_DWT_CYCCNT;
+        for (uint32_t i = 0; i < kSamples; ++i)
+        {
+            decimator.Add(input[i % kInputSize], output);
+            __asm__ volatile("" ::: "memory");
+        }
+        const uint32_t cycles = ARM_DWT_CYCCNT - start;
+        sink                  = output;
+
+        const uint32_t net = cycles > overhead ? cycles - overhead : 0;
+        return static_cast<uint32_t>(static_cast<uint64_t>(net) * 100 / kSamples);
+    }
+
+    /// Benchmarks the decimator configuration, reports the result and verifies that it stays within the cycle budget.
+    void Benchmark(const uint16_t ratio, const bool compensate)
+    {
+        const uint32_t cycles = MeasureCycles(ratio, compensate);
+
+        char message[96];
+        snprintf(
+            message,
+            sizeof(message),
+            "ratio %u, compensation %s: %lu.%02lu cycles per input sample",
+            ratio,
+            compensate ? "on" : "off",
+            static_cast<unsigned long>(cycles / 100),
+            static_cast<unsigned long>(cycles % 100)
+        );
+        TEST_MESSAGE(message);
+
+        // The decimator has to use less than 1% of the CPU time at a 100 kHz input rate (60 cycles per sample).
+        TEST_ASSERT_LESS_THAN(6000, cycles);
+    }
+}  // namespace
+
+void setUp()
+{}
+
+void tearDown()
+{}
+
+void test_ratio_10()
+{
+    Benchmark(10, false);
+    Benchmark(10, true);
+}
+
+void test_ratio_100()
+{
+    Benchmark(100, false);
+    Benchmark(100, true);
+}
+
+void setup()
+{
+    // Gives the test runner time to open the serial port after the board resets.
+    delay(2000);
+
+    for (uint16_t i = 0; i < kInputSize; ++i)
+    {
+        input[i] = static_cast<uint16_t>(i < kInputSize / 2 ? i * 8 : (kInputSize - i) * 8);
+    }
+
+    UNITY_BEGIN();
+    RUN_TEST(test_ratio_10);
+    RUN_TEST(test_ratio_100);
+    UNITY_END();
+}
+
+void loop()
+{}
@@ -0,0 +1,175 @@
+// Verifies that the LickEventDetector converts the sensor signal into lick events with the expected onset, duration,
+// peak and inter-lick interval. Run with: pio test -e native -f test_lick_events
+
+#include <unity.h>
+#include <cstdint>
+#include "lick_events.h"
+
+namespace
+{
+    /// The threshold the signal has to reach for the lick to start.
+    constexpr uint16_t kUpper = 1000;
+
+    /// The threshold the signal has to fall below for the lick to end.
+    constexpr uint16_t kLower = 600;
+
+    /// The time, in microseconds, the signal has to stay below the lower threshold for the lick to end.
+    constexpr uint32_t kDebounce = 5000;
+
+    /// Returns the detector configured with the test thresholds.
+    LickEventDetector MakeDetector()
+    {
+        LickEventDetector detector;
+        detector.Configure(kUpper, kLower, kDebounce);
+        return detector;
+    }
+}  // namespace
+
+void setUp()
+{}
+
+void tearDown()
+{}
+
+/// Verifies that the lick starts at the upper threshold and only ends below the lower threshold.
+void test_hysteresis()
+{
+    auto detector = MakeDetector();
+
+    // The signal between the thresholds does not start a lick.
+    TEST_ASSERT_FALSE(detector.Add(kUpper - 1, 0));
+    TEST_ASSERT_FALSE(detector.TakeOnset());
+
+    TEST_ASSERT_FALSE(detector.Add(kUpper, 1000));
+    TEST_ASSERT_TRUE(detector.TakeOnset());
+    TEST_ASSERT_FALSE(detector.TakeOnset());
+
+    // The signal between the thresholds does not end the lick, no matter how long it lasts.
+    TEST_ASSERT_FALSE(detector.Add(kLower, 2000));
+    TEST_ASSERT_FALSE(detector.Add(kLower, 2000 + 10 * kDebounce));
+    TEST_ASSERT_FALSE(detector.Poll(2000 + 20 * kDebounce));
+
+    // The lick ends once the signal stays below the lower threshold for the debounce period.
+    const uint32_t offset = 2000 + 30 * kDebounce;
+    TEST_ASSERT_FALSE(detector.Add(kLower - 1, offset));
+    TEST_ASSERT_FALSE(detector.Add(0, offset + kDebounce - 1));
+    TEST_ASSERT_TRUE(detector.Add(0, offset + kDebounce));
+    TEST_ASSERT_EQUAL_UINT32(1000, detector.GetEvent().onset);
+    TEST_ASSERT_EQUAL_UINT32(offset - 1000, detector.GetEvent().duration);
+    TEST_ASSERT_FALSE(detector.TakeOnset());
+}
+
+/// Verifies that a contact break shorter than the debounce period is merged into the ongoing lick.
+void test_contact_break_merged()
+{
+    auto detector = MakeDetector();
+
+    TEST_ASSERT_FALSE(detector.Add(1500, 0));
+    TEST_ASSERT_TRUE(detector.TakeOnset());
+    TEST_ASSERT_FALSE(detector.Add(0, 10000));
+
+    // The contact resumes before the debounce period elapses, so no lick is completed and no new lick starts.
+    TEST_ASSERT_FALSE(detector.Add(1200, 10000 + kDebounce - 1));
+    TEST_ASSERT_FALSE(detector.TakeOnset());
+
+    // The merged lick lasts until the final offset.
+    TEST_ASSERT_FALSE(detector.Add(0, 30000));
+    TEST_ASSERT_TRUE(detector.Add(0, 30000 + kDebounce));
+    TEST_ASSERT_EQUAL_UINT32(0, detector.GetEvent().onset);
+    TEST_ASSERT_EQUAL_UINT32(30000, detector.GetEvent().duration);
+
+    // The same holds for the hardware-detected crossings.
+    TEST_ASSERT_FALSE(detector.AddCrossing(true, 1100, 100000));
+    TEST_ASSERT_FALSE(detector.AddCrossing(false, 500, 110000));
+    TEST_ASSERT_FALSE(detector.AddCrossing(true, 1300, 112000));
+    TEST_ASSERT_FALSE(detector.AddCrossing(false, 500, 120000));
+    TEST_ASSERT_TRUE(detector.Poll(120000 + kDebounce));
+    TEST_ASSERT_EQUAL_UINT32(100000, detector.GetEvent().onset);
+    TEST_ASSERT_EQUAL_UINT32(20000, detector.GetEvent().duration);
+    TEST_ASSERT_EQUAL_UINT32(1300, detector.GetEvent().peak);
+}
+
+/// Verifies that the peak is the largest value observed during the lick, including the values after a merged contact
+/// break.
+void test_peak()
+{
+    auto detector = MakeDetector();
+
+    // The values before the lick starts are not part of the lick.
+    TEST_ASSERT_FALSE(detector.Add(kUpper - 1, 0));
+    TEST_ASSERT_FALSE(detector.Add(1100, 1000));
+    TEST_ASSERT_FALSE(detector.Add(2500, 2000));
+    TEST_ASSERT_FALSE(detector.Add(1800, 3000));
+    TEST_ASSERT_FALSE(detector.Add(0, 4000));
+    TEST_ASSERT_FALSE(detector.Add(3000, 5000));
+    TEST_ASSERT_FALSE(detector.Add(0, 6000));
+    TEST_ASSERT_TRUE(detector.Poll(6000 + kDebounce));
+    TEST_ASSERT_EQUAL_UINT32(3000, detector.GetEvent().peak);
+
+    // The peak does not carry over into the next lick.
+    TEST_ASSERT_FALSE(detector.Add(1200, 20000));
+    TEST_ASSERT_FALSE(detector.Add(0, 21000));
+    TEST_ASSERT_TRUE(detector.Poll(21000 + kDebounce));
+    TEST_ASSERT_EQUAL_UINT32(1200, detector.GetEvent().peak);
+}
+
+/// Verifies that the inter-lick interval is measured between consecutive onsets and is 0 for the first lick.
+void test_inter_lick_interval()
+{
+    auto detector = MakeDetector();
+
+    const uint32_t onsets[] = {1000, 101000, 251000};
+    const uint32_t expected[] = {0, 100000, 150000};
+    for (uint8_t i = 0; i < 3; ++i)
+    {
+        TEST_ASSERT_FALSE(detector.Add(1500, onsets[i]));
+        TEST_ASSERT_FALSE(detector.Add(0, onsets[i] + 20000));
+        TEST_ASSERT_TRUE(detector.Poll(onsets[i] + 20000 + kDebounce));
+        TEST_ASSERT_EQUAL_UINT32(onsets[i], detector.GetEvent().onset);
+        TEST_ASSERT_EQUAL_UINT32(expected[i], detector.GetEvent().interval);
+    }
+
+    // Reconfiguring the detector discards the previous onset.
+    detector.Configure(kUpper, kLower, kDebounce);
+    TEST_ASSERT_FALSE(detector.Add(1500, 500000));
+    TEST_ASSERT_FALSE(detector.Add(0, 510000));
+    TEST_ASSERT_TRUE(detector.Poll(510000 + kDebounce));
+    TEST_ASSERT_EQUAL_UINT32(0, detector.GetEvent().interval);
+}
+
+/// Verifies that Poll() finalizes the lick when no new samples arrive, and only once.
+void test_poll_finalization()
+{
+    auto detector = MakeDetector();
+
+    TEST_ASSERT_FALSE(detector.AddCrossing(true, 1400, 1000));
+    TEST_ASSERT_FALSE(detector.AddCrossing(false, 500, 9000));
+
+    // No samples arrive after the offset, so the lick is only completed by polling.
+    TEST_ASSERT_FALSE(detector.Poll(9000 + kDebounce - 1));
+    TEST_ASSERT_TRUE(detector.Poll(9000 + kDebounce));
+    TEST_ASSERT_EQUAL_UINT32(1000, detector.GetEvent().onset);
+    TEST_ASSERT_EQUAL_UINT32(8000, detector.GetEvent().duration);
+    TEST_ASSERT_EQUAL_UINT32(1400, detector.GetEvent().peak);
+    TEST_ASSERT_FALSE(detector.Poll(9000 + 2 * kDebounce));
+
+    // Polling never completes an ongoing contact.
+    TEST_ASSERT_FALSE(detector.AddCrossing(true, 1400, 50000));
+    TEST_ASSERT_FALSE(detector.Poll(50000 + 100 * kDebounce));
+
+    // The debounce period is measured with modular arithmetic, so it survives the micros() overflow.
+    TEST_ASSERT_FALSE(detector.AddCrossing(false, 500, UINT32_MAX - 1000));
+    TEST_ASSERT_FALSE(detector.Poll(UINT32_MAX));
+    TEST_ASSERT_TRUE(detector.Poll(kDebounce - 1001));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_hysteresis);
+    RUN_TEST(test_contact_break_merged);
+    RUN_TEST(test_peak);
+    RUN_TEST(test_inter_lick_interval);
+    RUN_TEST(test_poll_finalization);
+    return UNITY_END();
+}
@@ -0,0 +1,130 @@
+// Verifies that the LickScan reports the significant sensor changes and packs them into the LickArrayModule message.
+// Run with: pio test -e native -f test_lick_scan
+
+#include <unity.h>
+#include <cstdint>
+#include "lick_scan.h"
+
+namespace
+{
+    /// The signal threshold used by all tests.
+    constexpr uint16_t kSignalThreshold = 200;
+
+    /// The delta threshold used by all tests.
+    constexpr uint16_t kDeltaThreshold = 180;
+
+    /// Runs a single scan that adds the readouts of all sensors. Returns true if any sensor changed.
+    template <uint8_t kCount>
+    bool Scan(LickScan<kCount>& scan, const uint16_t (&readouts)[kCount])
+    {
+        scan.Begin();
+        for (uint8_t i = 0; i < kCount; ++i) scan.Add(i, readouts[i], kSignalThreshold, kDeltaThreshold);
+        return scan.HasChanges();
+    }
+}  // namespace
+
+void setUp()
+{}
+
+void tearDown()
+{}
+
+/// Verifies the message size and the initial message that reports all sensors at 0.
+void test_initial_message()
+{
+    TEST_ASSERT_EQUAL(2, LickScan<1>::kMessageSize);
+    TEST_ASSERT_EQUAL(4, LickScan<3>::kMessageSize);
+    TEST_ASSERT_EQUAL(9, LickScan<8>::kMessageSize);
+
+    const auto& single = LickScan<1>::GetInitialMessage();
+    TEST_ASSERT_EQUAL_UINT16(0x01, single[0]);
+    TEST_ASSERT_EQUAL_UINT16(0, single[1]);
+
+    const auto& full = LickScan<8>::GetInitialMessage();
+    TEST_ASSERT_EQUAL_UINT16(0xFF, full[0]);
+    for (uint8_t i = 1; i < LickScan<8>::kMessageSize; ++i) TEST_ASSERT_EQUAL_UINT16(0, full[i]);
+
+    // The zero readouts that follow the initial message are not reported again.
+    LickScan<3> scan;
+    scan.Reset();
+    TEST_ASSERT_FALSE(Scan(scan, {0, 0, 0}));
+}
+
+/// Verifies that bit i of the bitmask and the value at index i + 1 belong to the same sensor.
+void test_packing()
+{
+    LickScan<8> scan;
+    scan.Reset();
+
+    TEST_ASSERT_TRUE(Scan(scan, {0, 1000, 0, 0, 0, 2000, 0, 4000}));
+    const auto& message = scan.GetMessage();
+    TEST_ASSERT_EQUAL_UINT16(0xA2, message[0]);
+    const uint16_t expected[] = {0xA2, 0, 1000, 0, 0, 0, 2000, 0, 4000};
+    for (uint8_t i = 0; i < LickScan<8>::kMessageSize; ++i) TEST_ASSERT_EQUAL_UINT16(expected[i], message[i]);
+
+    // The next scan only reports the sensors that changed again and clears the values of the unchanged sensors.
+    TEST_ASSERT_TRUE(Scan(scan, {0, 1000, 0, 0, 0, 2000, 0, 3000}));
+    TEST_ASSERT_EQUAL_UINT16(0x80, message[0]);
+    for (uint8_t i = 1; i < 8; ++i) TEST_ASSERT_EQUAL_UINT16(0, message[i]);
+    TEST_ASSERT_EQUAL_UINT16(3000, message[8]);
+
+    // Out-of-range sensor indices are ignored.
+    scan.Begin();
+    scan.Add(8, 4000, kSignalThreshold, kDeltaThreshold);
+    TEST_ASSERT_FALSE(scan.HasChanges());
+}
+
+/// Verifies that readouts within the delta threshold of the previous significant readout are not reported.
+void test_delta_threshold()
+{
+    LickScan<1> scan;
+    scan.Reset();
+
+    // The delta has to exceed the threshold, so a delta equal to it is ignored.
+    TEST_ASSERT_FALSE(Scan(scan, {kDeltaThreshold}));
+    TEST_ASSERT_TRUE(Scan(scan, {kSignalThreshold + kDeltaThreshold}));
+
+    // The deltas are measured against the last significant readout, so slow drifts are reported once they accumulate.
+    TEST_ASSERT_FALSE(Scan(scan, {kSignalThreshold + kDeltaThreshold + 100}));
+    TEST_ASSERT_FALSE(Scan(scan, {kSignalThreshold + kDeltaThreshold + 180}));
+    TEST_ASSERT_TRUE(Scan(scan, {kSignalThreshold + kDeltaThreshold + 181}));
+    TEST_ASSERT_EQUAL_UINT16(kSignalThreshold + kDeltaThreshold + 181, scan.GetMessage()[1]);
+}
+
+/// Verifies that the below-threshold readouts are pulled to 0 and only reported once.
+void test_zero_reported_once()
+{
+    LickScan<3> scan;
+    scan.Reset();
+
+    TEST_ASSERT_TRUE(Scan(scan, {0, 1500, 0}));
+    TEST_ASSERT_EQUAL_UINT16(0x02, scan.GetMessage()[0]);
+
+    // A significant drop below the signal threshold is reported as 0.
+    TEST_ASSERT_TRUE(Scan(scan, {0, 150, 0}));
+    TEST_ASSERT_EQUAL_UINT16(0x02, scan.GetMessage()[0]);
+    TEST_ASSERT_EQUAL_UINT16(0, scan.GetMessage()[2]);
+
+    // Further significant changes that stay below the signal threshold are not reported.
+    TEST_ASSERT_FALSE(Scan(scan, {0, 0, 0}));
+    TEST_ASSERT_FALSE(Scan(scan, {0, 190, 0}));
+
+    // The sensor is reported again once it rises above the signal threshold.
+    TEST_ASSERT_TRUE(Scan(scan, {0, 1200, 0}));
+    TEST_ASSERT_EQUAL_UINT16(1200, scan.GetMessage()[2]);
+
+    // Reset() restores the initial state, where all sensors are assumed to be reported at 0.
+    scan.Reset();
+    TEST_ASSERT_FALSE(scan.HasChanges());
+    TEST_ASSERT_FALSE(Scan(scan, {150, 0, 0}));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_initial_message);
+    RUN_TEST(test_packing);
+    RUN_TEST(test_delta_threshold);
+    RUN_TEST(test_zero_reported_once);
+    return UNITY_END();
+}
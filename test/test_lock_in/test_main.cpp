@@ -0,0 +1,144 @@
+// Verifies that the LockInDemodulator recovers the amplitude and phase of the excitation-frequency component and
+// rejects the components at other frequencies. Run with: pio test -e native -f test_lock_in
+
+#include <unity.h>
+#include <cmath>
+#include <cstdint>
+#include <initializer_list>
+#include "lock_in.h"
+
+namespace
+{
+    /// The excitation frequency, in Hz.
+    constexpr uint16_t kFrequency = 211;
+
+    /// The interval between samples, in microseconds (10 kHz).
+    constexpr uint32_t kInterval = 100;
+
+    /// The number of samples in each window (1 second).
+    constexpr uint16_t kWindow = 10000;
+
+    /// Describes a single sinusoidal signal component.
+    struct Component
+    {
+            double frequency;  ///< The frequency, in Hz.
+            double amplitude;  ///< The amplitude, in ADC units.
+            double phase;      ///< The phase at timestamp 0, in radians.
+    };
+
+    /// Feeds one window of the 12-bit signal made of the mid-scale offset and the components to the demodulator,
+    /// starting at the given timestamp. Returns true if the last sample completed the window.
+    template <size_t kCount>
+    bool FeedWindow(LockInDemodulator& demodulator, const Component (&components)[kCount], const uint32_t start)
+    {
+        bool complete = false;
+        for (uint16_t n = 0; n < kWindow; ++n)
+        {
+            const uint32_t timestamp = start + n * kInterval;
+            double value             = 2048.0;
+            for (const auto& component : components)
+            {
+                value += component.amplitude *
+                         std::cos(2.0 * M_PI * component.frequency * timestamp / 1e6 + component.phase);
+            }
+            complete = demodulator.Add(static_cast<uint16_t>(std::lround(value)), timestamp);
+            TEST_ASSERT_TRUE(complete == (n == kWindow - 1));
+        }
+        return complete;
+    }
+
+    /// Converts the Q16.16 amplitude into ADC units.
+    double Amplitude(const LockInDemodulator& demodulator)
+    {
+        return demodulator.GetAmplitude() / 65536.0;
+    }
+
+    /// Converts the phase into radians in the range -pi to pi.
+    double Phase(const LockInDemodulator& demodulator)
+    {
+        return static_cast<int32_t>(demodulator.GetPhase()) / 4294967296.0 * 2.0 * M_PI;
+    }
+}  // namespace
+
+void setUp()
+{}
+
+void tearDown()
+{}
+
+/// Recovers the amplitude and phase of the reference-frequency component across the full phase circle.
+void test_reference_component()
+{
+    LockInDemodulator demodulator;
+    demodulator.Configure(kFrequency, kWindow);
+    TEST_ASSERT_TRUE(demodulator.IsEnabled());
+
+    for (const double phase : {0.0, 0.5, 1.5, 3.0, -3.0, -1.0})
+    {
+        const Component signal[] = {{kFrequency, 500.0, phase}};
+        TEST_ASSERT_TRUE(FeedWindow(demodulator, signal, 0));
+        TEST_ASSERT_FLOAT_WITHIN(1.0, 500.0, Amplitude(demodulator));
+        TEST_ASSERT_FLOAT_WITHIN(0.01, phase, Phase(demodulator));
+    }
+}
+
+/// Recovers the phase relative to the timestamp-derived oscillator for a window that does not start at timestamp 0
+/// and does not span a whole number of excitation periods.
+void test_window_start()
+{
+    LockInDemodulator demodulator;
+    demodulator.Configure(kFrequency, kWindow);
+
+    const Component signal[] = {{kFrequency, 100.0, 1.0}};
+    TEST_ASSERT_TRUE(FeedWindow(demodulator, signal, 1234567));
+    TEST_ASSERT_EQUAL_UINT32(1234567, demodulator.GetStart());
+    TEST_ASSERT_FLOAT_WITHIN(0.5, 100.0, Amplitude(demodulator));
+    TEST_ASSERT_FLOAT_WITHIN(0.02, 1.0, Phase(demodulator));
+}
+
+/// Rejects the off-frequency components, both alone and next to a small reference-frequency component.
+void test_off_frequency_rejection()
+{
+    LockInDemodulator demodulator;
+    demodulator.Configure(kFrequency, kWindow);
+
+    // A component whose beat with the reference completes a whole number of periods in the window cancels out.
+    const Component aligned[] = {{kFrequency + 20.0, 1000.0, 0.3}};
+    TEST_ASSERT_TRUE(FeedWindow(demodulator, aligned, 0));
+    TEST_ASSERT_LESS_THAN(6554, demodulator.GetAmplitude());  // 0.1 ADC units.
+
+    // Any other component leaks by at most amplitude / (pi * frequency difference * window duration), which is
+    // 1000 / (pi * 23.5 * 1) = 13.5 ADC units here.
+    const Component misaligned[] = {{kFrequency + 23.5, 1000.0, 0.3}};
+    TEST_ASSERT_TRUE(FeedWindow(demodulator, misaligned, 0));
+    TEST_ASSERT_LESS_THAN(14 * 65536, demodulator.GetAmplitude());
+
+    // A large, slow drift has to leave less than 0.5% of its amplitude.
+    const Component drift[] = {{0.5, 1000.0, 0.0}};
+    TEST_ASSERT_TRUE(FeedWindow(demodulator, drift, 0));
+    TEST_ASSERT_LESS_THAN(5 * 65536, demodulator.GetAmplitude());
+
+    // The small reference-frequency component is still recovered next to the large off-frequency component.
+    const Component mixed[] = {{kFrequency, 20.0, -0.7}, {kFrequency + 20.0, 1000.0, 0.3}};
+    TEST_ASSERT_TRUE(FeedWindow(demodulator, mixed, 0));
+    TEST_ASSERT_FLOAT_WITHIN(0.2, 20.0, Amplitude(demodulator));
+    TEST_ASSERT_FLOAT_WITHIN(0.02, -0.7, Phase(demodulator));
+}
+
+/// Verifies that a zero window disables the demodulator.
+void test_disabled()
+{
+    LockInDemodulator demodulator;
+    demodulator.Configure(kFrequency, 0);
+    TEST_ASSERT_FALSE(demodulator.IsEnabled());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_reference_component);
+    RUN_TEST(test_window_start);
+    RUN_TEST(test_off_frequency_rejection);
+    RUN_TEST(test_disabled);
+    return UNITY_END();
+}
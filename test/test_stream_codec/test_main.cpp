@@ -0,0 +1,234 @@
+// Verifies that the DeltaFrameEncoder and DecodeDeltaFrame() round-trip the samples exactly, measures the compression
+// ratio of both encodings on synthetic photometry traces and benchmarks the encoding and decoding throughput on the
+// host-PC. Run with: pio test -e native -f test_stream_codec
+
+#include <unity.h>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "stream_codec.h"
+
+namespace
+{
+    /// Stores a single encoded frame as the bytes received by the PC.
+    struct Frame
+    {
+            uint8_t bytes[kDeltaFrameSize] = {};
+    };
+
+    /// Encodes the samples into as many frames as needed.
+    std::vector<Frame> Encode(const std::vector<uint16_t>& samples, const kDeltaEncodings encoding)
+    {
+        std::vector<Frame> frames;
+        DeltaFrameEncoder encoder;
+        encoder.Reset(encoding);
+
+        auto flush = [&]
+        {
+            const auto& words = encoder.Finalize(0, 1);
+            Frame frame;
+            for (uint8_t i = 0; i < kDeltaFrameSize; ++i)
+            {
+                frame.bytes[i] = static_cast<uint8_t>(words[i / 4] >> (i % 4 * 8));
+            }
+            frames.push_back(frame);
+            encoder.Reset(encoding);
+        };
+
+        for (const uint16_t sample : samples)
+        {
+            if (encoder.Append(sample)) continue;
+            flush();
+            TEST_ASSERT_TRUE(encoder.Append(sample));  // The sample always fits into an empty frame.
+        }
+        if (encoder.GetCount() != 0) flush();
+        return frames;
+    }
+
+    /// Decodes the frames and returns the concatenated samples.
+    std::vector<uint16_t> Decode(const std::vector<Frame>& frames)
+    {
+        std::vector<uint16_t> samples;
+        uint16_t buffer[UINT8_MAX];
+        for (const auto& frame : frames)
+        {
+            uint32_t timestamp;
+            uint16_t interval;
+            const uint8_t count = DecodeDeltaFrame(frame.bytes, buffer, UINT8_MAX, timestamp, interval);
+            TEST_ASSERT_GREATER_THAN(0, count);
+            samples.insert(samples.end(), buffer, buffer + count);
+        }
+        return samples;
+    }
+
+    /// Encodes and decodes the samples and verifies that they are unchanged.
+    void VerifyRoundTrip(const std::vector<uint16_t>& samples, const kDeltaEncodings encoding)
+    {
+        const std::vector<uint16_t> decoded = Decode(Encode(samples, encoding));
+        TEST_ASSERT_EQUAL(samples.size(), decoded.size());
+        TEST_ASSERT_EQUAL_UINT16_ARRAY(samples.data(), decoded.data(), samples.size());
+    }
+
+    /// Generates a synthetic 12-bit photometry trace: a slow 1 Hz, 200 LSB oscillation around mid-scale sampled at
+    /// 1 kHz, plus Gaussian noise with the given standard deviation in ADC units.
+    std::vector<uint16_t> MakeTrace(const double noise, const size_t length = 100000)
+    {
+        std::mt19937 generator(12345);
+        std::normal_distribution<double> distribution(0.0, noise);
+        std::vector<uint16_t> samples(length);
+        for (size_t i = 0; i < length; ++i)
+        {
+            double value = 2048.0 + 200.0 * std::sin(2.0 * M_PI * static_cast<double>(i) / 1000.0);
+            if (noise > 0) value += distribution(generator);
+            value      = std::round(value);
+            samples[i] = static_cast<uint16_t>(value < 0 ? 0 : value > 4095 ? 4095 : value);
+        }
+        return samples;
+    }
+
+    /// Returns the ratio of the raw uint16 sample bytes to the encoded frame bytes.
+    double MeasureRatio(const std::vector<uint16_t>& samples, const kDeltaEncodings encoding)
+    {
+        const std::vector<Frame> frames = Encode(samples, encoding);
+        const auto raw_bytes     = static_cast<double>(samples.size() * sizeof(uint16_t));
+        const auto encoded_bytes = static_cast<double>(frames.size() * kDeltaFrameSize);
+        return raw_bytes / encoded_bytes;
+    }
+}  // namespace
+
+void setUp()
+{}
+
+void tearDown()
+{}
+
+/// Round-trips noisy photometry traces with both encodings.
+void test_round_trip_photometry()
+{
+    for (const double noise : {0.0, 1.0, 4.0, 32.0})
+    {
+        const std::vector<uint16_t> samples = MakeTrace(noise, 20000);
+        VerifyRoundTrip(samples, kDeltaEncodings::kVarint);
+        VerifyRoundTrip(samples, kDeltaEncodings::kNibble);
+    }
+}
+
+/// Round-trips the differences at the edges of every code width, including full-scale jumps in both directions.
+void test_sign_extremes()
+{
+    const int32_t deltas[] = {0, 7, -7, 8, -8, 63, -64, 64, -65, 127, -127, 128, -128, 8191, -8192, 8192, -8193};
+    std::vector<uint16_t> samples = {32768};
+    for (const int32_t delta : deltas)
+    {
+        samples.push_back(static_cast<uint16_t>(samples.back() + delta));
+        samples.push_back(32768);
+    }
+    for (const uint16_t extreme : {0, 65535, 0, 65535, 65535, 0}) samples.push_back(extreme);
+
+    VerifyRoundTrip(samples, kDeltaEncodings::kVarint);
+    VerifyRoundTrip(samples, kDeltaEncodings::kNibble);
+}
+
+/// Verifies the frame capacity, that wide codes that do not fit close the frame instead of being split, and that the
+/// decoder rejects malformed frames.
+void test_frame_boundaries()
+{
+    // A constant signal fills each frame to its maximum capacity.
+    const std::vector<uint16_t> constant(1000, 1234);
+    const std::vector<Frame> nibble = Encode(constant, kDeltaEncodings::kNibble);
+    const std::vector<Frame> varint = Encode(constant, kDeltaEncodings::kVarint);
+    TEST_ASSERT_EQUAL_UINT8(101, nibble[0].bytes[6]);
+    TEST_ASSERT_EQUAL_UINT8(51, varint[0].bytes[6]);
+    VerifyRoundTrip(constant, kDeltaEncodings::kNibble);
+    VerifyRoundTrip(constant, kDeltaEncodings::kVarint);
+
+    // Leaves 3 free codes at the end of the nibble frame, so that the following raw code (7 codes) does not fit.
+    std::vector<uint16_t> samples(98, 100);
+    samples.push_back(40000);
+    samples.push_back(100);
+    const std::vector<Frame> split = Encode(samples, kDeltaEncodings::kNibble);
+    TEST_ASSERT_EQUAL(2, split.size());
+    TEST_ASSERT_EQUAL_UINT8(98, split[0].bytes[6]);
+    TEST_ASSERT_EQUAL_UINT8(2, split[1].bytes[6]);
+    VerifyRoundTrip(samples, kDeltaEncodings::kNibble);
+
+    // A single-sample frame only stores the keyframe.
+    VerifyRoundTrip({4095}, kDeltaEncodings::kNibble);
+
+    // Rejects frames that do not fit into the output array, frames with an unknown encoding and frames whose payload
+    // ends in the middle of a code.
+    Frame frame = nibble[0];
+    uint16_t buffer[UINT8_MAX];
+    uint32_t timestamp;
+    uint16_t interval;
+    TEST_ASSERT_EQUAL_UINT8(0, DecodeDeltaFrame(frame.bytes, buffer, 100, timestamp, interval));
+    frame.bytes[7] = 3;
+    TEST_ASSERT_EQUAL_UINT8(0, DecodeDeltaFrame(frame.bytes, buffer, UINT8_MAX, timestamp, interval));
+    frame                            = nibble[0];
+    frame.bytes[kDeltaFrameSize - 1] = DeltaFrameEncoder::kNibbleEscape << 4;
+    TEST_ASSERT_EQUAL_UINT8(0, DecodeDeltaFrame(frame.bytes, buffer, UINT8_MAX, timestamp, interval));
+}
+
+/// Measures the compression ratio of both encodings on the synthetic photometry traces with increasing noise. The
+/// ratio does not include the transport layer framing of each message.
+void test_compression_ratio()
+{
+    char message[128];
+    for (const double noise : {0.5, 1.0, 2.0, 4.0, 8.0, 16.0})
+    {
+        const std::vector<uint16_t> samples = MakeTrace(noise);
+        const double nibble                 = MeasureRatio(samples, kDeltaEncodings::kNibble);
+        const double varint                 = MeasureRatio(samples, kDeltaEncodings::kVarint);
+        snprintf(message, sizeof(message), "noise %4.1f LSB: nibble %.2fx, varint %.2fx", noise, nibble, varint);
+        TEST_MESSAGE(message);
+
+        // Neither encoding may inflate the realistic traces.
+        TEST_ASSERT_TRUE(nibble > 1.0);
+        TEST_ASSERT_TRUE(varint > 1.0);
+    }
+
+    // The hardware-averaged readouts have about 1 LSB of noise, for which the nibble encoding has to reach 3x.
+    TEST_ASSERT_TRUE(MeasureRatio(MakeTrace(1.0), kDeltaEncodings::kNibble) >= 3.0);
+}
+
+/// Benchmarks the encoding and decoding throughput on the host-PC.
+void test_throughput()
+{
+    const std::vector<uint16_t> samples = MakeTrace(2.0, 1000000);
+    char message[128];
+    for (const kDeltaEncodings encoding : {kDeltaEncodings::kNibble, kDeltaEncodings::kVarint})
+    {
+        const auto start                    = std::chrono::steady_clock::now();
+        const std::vector<Frame> frames     = Encode(samples, encoding);
+        const auto encoded                  = std::chrono::steady_clock::now();
+        const std::vector<uint16_t> decoded = Decode(frames);
+        const auto end                      = std::chrono::steady_clock::now();
+        TEST_ASSERT_EQUAL(samples.size(), decoded.size());
+
+        const double encode_seconds = std::chrono::duration<double>(encoded - start).count();
+        const double decode_seconds = std::chrono::duration<double>(end - encoded).count();
+        snprintf(
+            message,
+            sizeof(message),
+            "%s: encode %.1f Msamples/s, decode %.1f Msamples/s",
+            encoding == kDeltaEncodings::kNibble ? "nibble" : "varint",
+            static_cast<double>(samples.size()) / encode_seconds / 1e6,
+            static_cast<double>(samples.size()) / decode_seconds / 1e6
+        );
+        TEST_MESSAGE(message);
+    }
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip_photometry);
+    RUN_TEST(test_sign_extremes);
+    RUN_TEST(test_frame_boundaries);
+    RUN_TEST(test_compression_ratio);
+    RUN_TEST(test_throughput);
+    return UNITY_END();
+}